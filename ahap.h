@@ -0,0 +1,480 @@
+#pragma once
+
+// Typed decoder for AHAP (Apple Haptic and Audio Pattern) files. The pattern is read straight from
+// json_scanner into flat arrays, without a DOM in between: events and curves are stored in file
+// order, one array per field, their parameters and control points in shared arrays that each entry
+// indexes into. Parameter IDs and event types become enums, times and values floats.
+
+#include "jparser.h"
+
+enum class haptic_event_type : uint8_t
+{
+	haptic_transient,
+	haptic_continuous,
+	audio_custom,
+	audio_continuous,
+};
+
+// Parameters that are set once per event (EventParameters)
+enum class haptic_event_parameter : uint8_t
+{
+	haptic_intensity,
+	haptic_sharpness,
+	attack_time,
+	decay_time,
+	release_time,
+	sustained,
+	audio_volume,
+	audio_pan,
+	audio_pitch,
+	audio_brightness,
+};
+
+// Parameters that change over time (Parameter and ParameterCurve entries)
+enum class haptic_dynamic_parameter : uint8_t
+{
+	haptic_intensity_control,
+	haptic_sharpness_control,
+	haptic_attack_time_control,
+	haptic_decay_time_control,
+	haptic_release_time_control,
+	audio_volume_control,
+	audio_pan_control,
+	audio_pitch_control,
+	audio_brightness_control,
+};
+
+// One event as seen through a haptic_pattern_view
+struct haptic_event {
+	float time;
+	float duration;		// continuous and audio events only, 0 otherwise
+	haptic_event_type type;
+	JsonString waveform;	// audio_custom only
+	span<const haptic_event_parameter> parameter_ids;
+	span<const float> parameter_values;
+};
+
+// A ParameterCurve, or a single Parameter entry as a curve with one point at its start.
+// Point times are relative to the start of the curve.
+struct haptic_curve {
+	float time;
+	haptic_dynamic_parameter id;
+	span<const float> point_times;
+	span<const float> point_values;
+};
+
+// Read-only view of a pattern as parallel arrays, one per field (structure of arrays). The same view
+// covers a decoded HapticPattern and a mapped binary file (see ahap_binary.h). Entries own ranges of
+// the shared arrays through offset arrays one longer than the entries: the parameters of event i are
+// [event_parameters[i], event_parameters[i + 1]), the same goes for curve_points and string_offsets.
+struct haptic_pattern_view {
+	double version = 0;
+	span<const char> strings;				// metadata and waveform paths, back to back
+	span<const uint32_t> string_offsets;
+	span<const uint32_t> metadata;			// key and value string of each Metadata member, in file order
+	span<const float> event_time;
+	span<const float> event_duration;
+	span<const int32_t> event_waveform;		// string index, -1 without a waveform
+	span<const uint32_t> event_parameters;
+	span<const haptic_event_type> event_type;
+	span<const float> parameter_value;
+	span<const haptic_event_parameter> parameter_id;
+	span<const float> curve_time;
+	span<const uint32_t> curve_points;
+	span<const haptic_dynamic_parameter> curve_id;
+	span<const float> point_time;
+	span<const float> point_value;
+
+	size_t event_count() const { return event_time.size(); }
+	size_t curve_count() const { return curve_time.size(); }
+	size_t metadata_count() const { return metadata.size() / 2; }
+
+	JsonString string(uint32_t i) const {
+		return { strings.data() + string_offsets[i], string_offsets[i + 1] - string_offsets[i] };
+	}
+
+	std::pair<JsonString, JsonString> metadata_entry(size_t i) const {
+		return { string(metadata[2 * i]), string(metadata[2 * i + 1]) };
+	}
+
+	haptic_event event(size_t i) const {
+		const auto first = event_parameters[i], count = event_parameters[i + 1] - first;
+		return { event_time[i], event_duration[i], event_type[i], event_waveform[i] < 0 ? JsonString() : string(event_waveform[i]),
+			parameter_id.subspan(first, count), parameter_value.subspan(first, count) };
+	}
+
+	haptic_curve curve(size_t i) const {
+		const auto first = curve_points[i], count = curve_points[i + 1] - first;
+		return { curve_time[i], curve_id[i], point_time.subspan(first, count), point_value.subspan(first, count) };
+	}
+};
+
+// A decoded pattern, owning the arrays of haptic_pattern_view. Entries are appended field by field:
+// parameters or points first, then the event or curve that closes over them.
+struct HapticPattern {
+	double version = 0;
+	std::string strings;
+	std::vector<uint32_t> string_offsets{ 0 };
+	std::vector<uint32_t> metadata;
+	std::vector<float> event_time;
+	std::vector<float> event_duration;
+	std::vector<int32_t> event_waveform;
+	std::vector<uint32_t> event_parameters{ 0 };
+	std::vector<haptic_event_type> event_type;
+	std::vector<float> parameter_value;
+	std::vector<haptic_event_parameter> parameter_id;
+	std::vector<float> curve_time;
+	std::vector<uint32_t> curve_points{ 0 };
+	std::vector<haptic_dynamic_parameter> curve_id;
+	std::vector<float> point_time;
+	std::vector<float> point_value;
+
+	uint32_t add_string(JsonString text) {
+		strings += text;
+		string_offsets.push_back(static_cast<uint32_t>(strings.size()));
+		return static_cast<uint32_t>(string_offsets.size() - 2);
+	}
+
+	void add_metadata(JsonString key, JsonString value) {
+		metadata.push_back(add_string(key));
+		metadata.push_back(add_string(value));
+	}
+
+	void add_parameter(haptic_event_parameter id, float value) {
+		parameter_id.push_back(id);
+		parameter_value.push_back(value);
+	}
+
+	// Owns the parameters added since the previous event
+	void add_event(float time, haptic_event_type type, float duration, int32_t waveform) {
+		event_time.push_back(time);
+		event_duration.push_back(duration);
+		event_waveform.push_back(waveform);
+		event_parameters.push_back(static_cast<uint32_t>(parameter_id.size()));
+		event_type.push_back(type);
+	}
+
+	void add_point(float time, float value) {
+		point_time.push_back(time);
+		point_value.push_back(value);
+	}
+
+	// Owns the points added since the previous curve
+	void add_curve(float time, haptic_dynamic_parameter id) {
+		curve_time.push_back(time);
+		curve_points.push_back(static_cast<uint32_t>(point_time.size()));
+		curve_id.push_back(id);
+	}
+
+	haptic_pattern_view view() const {
+		return { version, { strings.data(), strings.size() }, { string_offsets.data(), string_offsets.size() }, { metadata.data(), metadata.size() },
+			{ event_time.data(), event_time.size() }, { event_duration.data(), event_duration.size() },
+			{ event_waveform.data(), event_waveform.size() }, { event_parameters.data(), event_parameters.size() },
+			{ event_type.data(), event_type.size() }, { parameter_value.data(), parameter_value.size() },
+			{ parameter_id.data(), parameter_id.size() }, { curve_time.data(), curve_time.size() },
+			{ curve_points.data(), curve_points.size() }, { curve_id.data(), curve_id.size() },
+			{ point_time.data(), point_time.size() }, { point_value.data(), point_value.size() } };
+	}
+
+	void clear() {
+		version = 0;
+		strings.clear();
+		string_offsets.assign(1, 0);
+		metadata.clear();
+		event_time.clear();
+		event_duration.clear();
+		event_waveform.clear();
+		event_parameters.assign(1, 0);
+		event_type.clear();
+		parameter_value.clear();
+		parameter_id.clear();
+		curve_time.clear();
+		curve_points.assign(1, 0);
+		curve_id.clear();
+		point_time.clear();
+		point_value.clear();
+	}
+};
+
+// Spellings of the enums above, in declaration order
+inline constexpr const char* HapticEventTypeNames[] = { "HapticTransient", "HapticContinuous", "AudioCustom", "AudioContinuous" };
+inline constexpr const char* HapticEventParameterNames[] = {
+	"HapticIntensity", "HapticSharpness", "AttackTime", "DecayTime", "ReleaseTime", "Sustained",
+	"AudioVolume", "AudioPan", "AudioPitch", "AudioBrightness" };
+inline constexpr const char* HapticDynamicParameterNames[] = {
+	"HapticIntensityControl", "HapticSharpnessControl", "HapticAttackTimeControl", "HapticDecayTimeControl",
+	"HapticReleaseTimeControl", "AudioVolumeControl", "AudioPanControl", "AudioPitchControl", "AudioBrightnessControl" };
+
+template<typename Enum, size_t N>
+bool find_name(const char* const (&names)[N], JsonString text, Enum& value) {
+	for (size_t i = 0; i < N; i++) {
+		if (text == names[i]) {
+			value = static_cast<Enum>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Members the decoder does not know are skipped, so newer files still load.
+// A decoder can be reused; its pattern keeps its capacity between files.
+struct ahap_parser : json_scanner {
+	ahap_parser() {}
+	ahap_parser(std::string json, parse_options opts = {}) :json_scanner(std::move(json), opts) {}
+
+	// Decodes into pattern, which is cleared first. False with error() set on failure.
+	bool decode(HapticPattern& pattern) {
+		rewind();
+		pattern.clear();
+		m_pattern = &pattern;
+		bool hasVersion = false, hasPattern = false;
+		const auto start = value_start();
+		const bool ok = parse_members([&](JsonString key) {
+			if (key == "Version") {
+				hasVersion = true;
+				return parse_number(pattern.version);
+			}
+			if (key == "Metadata") {
+				return parse_metadata();
+			}
+			if (key == "Pattern") {
+				hasPattern = true;
+				return parse_elements([&] { return parse_entry(); });
+			}
+			return skip_value();
+			});
+		m_pattern = nullptr;
+		if (ok && (!hasVersion || !hasPattern)) {
+			return fail_at(start, error_kind::invalid_schema);
+		}
+		return ok && expect_end();
+	}
+
+	expected<HapticPattern, json_error> try_parse() {
+		HapticPattern pattern;
+		if (!decode(pattern)) {
+			return make_unexpected(error());
+		}
+		return pattern;
+	}
+
+#if !defined(JPARSER_NO_EXCEPTIONS)
+	HapticPattern parse() {
+		auto result = try_parse();
+		if (!result) {
+			throw parse_error(result.error());
+		}
+		return std::move(*result);
+	}
+#endif
+
+private:
+	HapticPattern* m_pattern = nullptr;
+
+	// Offset of the value about to be read, for errors that refer to the whole value
+	size_t value_start() {
+		peek();
+		return pos;
+	}
+
+	bool parse_float(float& value) {
+		double number;
+		if (!parse_number(number)) {
+			return false;
+		}
+		value = static_cast<float>(number);
+		return true;
+	}
+
+	template<typename Enum, size_t N>
+	bool parse_enum(const char* const (&names)[N], Enum& value) {
+		const auto start = value_start();
+		JsonString text;
+		if (!parse_string(text)) {
+			return false;
+		}
+		return find_name(names, text, value) || fail_at(start, error_kind::invalid_schema);
+	}
+
+	bool parse_metadata() {
+		return parse_members([&](JsonString key) {
+			if (peek() != '"') {
+				return skip_value();
+			}
+			JsonString text;
+			if (!parse_string(text)) {
+				return false;
+			}
+			m_pattern->add_metadata(key, text);
+			return true;
+			});
+	}
+
+	// One element of Pattern: {"Event": ...}, {"Parameter": ...} or {"ParameterCurve": ...}
+	bool parse_entry() {
+		return parse_members([&](JsonString key) {
+			if (key == "Event") {
+				return parse_event();
+			}
+			if (key == "ParameterCurve") {
+				return parse_curve();
+			}
+			if (key == "Parameter") {
+				return parse_parameter();
+			}
+			return skip_value();
+			});
+	}
+
+	bool parse_event() {
+		float time = 0, duration = 0;
+		haptic_event_type type{};
+		int32_t waveform = -1;
+		bool hasTime = false, hasType = false;
+		const auto start = value_start();
+		const bool ok = parse_members([&](JsonString key) {
+			if (key == "Time") {
+				hasTime = true;
+				return parse_float(time);
+			}
+			if (key == "EventType") {
+				hasType = true;
+				return parse_enum(HapticEventTypeNames, type);
+			}
+			if (key == "EventDuration") {
+				return parse_float(duration);
+			}
+			if (key == "EventWaveformPath") {
+				JsonString path;
+				if (!parse_string(path)) {
+					return false;
+				}
+				waveform = static_cast<int32_t>(m_pattern->add_string(path));
+				return true;
+			}
+			if (key == "EventParameters") {
+				return parse_elements([&] { return parse_event_parameter(); });
+			}
+			return skip_value();
+			});
+		if (!ok) {
+			return false;
+		}
+		if (!hasTime || !hasType) {
+			return fail_at(start, error_kind::invalid_schema);
+		}
+		m_pattern->add_event(time, type, duration, waveform);
+		return true;
+	}
+
+	bool parse_event_parameter() {
+		haptic_event_parameter id{};
+		float value = 0;
+		bool hasId = false, hasValue = false;
+		const auto start = value_start();
+		const bool ok = parse_members([&](JsonString key) {
+			if (key == "ParameterID") {
+				hasId = true;
+				return parse_enum(HapticEventParameterNames, id);
+			}
+			if (key == "ParameterValue") {
+				hasValue = true;
+				return parse_float(value);
+			}
+			return skip_value();
+			});
+		if (!ok) {
+			return false;
+		}
+		if (!hasId || !hasValue) {
+			return fail_at(start, error_kind::invalid_schema);
+		}
+		m_pattern->add_parameter(id, value);
+		return true;
+	}
+
+	bool parse_curve() {
+		float time = 0;
+		haptic_dynamic_parameter id{};
+		bool hasId = false, hasTime = false;
+		const auto start = value_start();
+		const bool ok = parse_members([&](JsonString key) {
+			if (key == "ParameterID") {
+				hasId = true;
+				return parse_enum(HapticDynamicParameterNames, id);
+			}
+			if (key == "Time") {
+				hasTime = true;
+				return parse_float(time);
+			}
+			if (key == "ParameterCurveControlPoints") {
+				return parse_elements([&] { return parse_control_point(); });
+			}
+			return skip_value();
+			});
+		if (!ok) {
+			return false;
+		}
+		if (!hasId || !hasTime) {
+			return fail_at(start, error_kind::invalid_schema);
+		}
+		m_pattern->add_curve(time, id);
+		return true;
+	}
+
+	bool parse_control_point() {
+		float time = 0, value = 0;
+		bool hasTime = false, hasValue = false;
+		const auto start = value_start();
+		const bool ok = parse_members([&](JsonString key) {
+			if (key == "Time") {
+				hasTime = true;
+				return parse_float(time);
+			}
+			if (key == "ParameterValue") {
+				hasValue = true;
+				return parse_float(value);
+			}
+			return skip_value();
+			});
+		if (!ok) {
+			return false;
+		}
+		if (!hasTime || !hasValue) {
+			return fail_at(start, error_kind::invalid_schema);
+		}
+		m_pattern->add_point(time, value);
+		return true;
+	}
+
+	bool parse_parameter() {
+		float time = 0, value = 0;
+		haptic_dynamic_parameter id{};
+		bool hasId = false, hasTime = false, hasValue = false;
+		const auto start = value_start();
+		const bool ok = parse_members([&](JsonString key) {
+			if (key == "ParameterID") {
+				hasId = true;
+				return parse_enum(HapticDynamicParameterNames, id);
+			}
+			if (key == "Time") {
+				hasTime = true;
+				return parse_float(time);
+			}
+			if (key == "ParameterValue") {
+				hasValue = true;
+				return parse_float(value);
+			}
+			return skip_value();
+			});
+		if (!ok) {
+			return false;
+		}
+		if (!hasId || !hasTime || !hasValue) {
+			return fail_at(start, error_kind::invalid_schema);
+		}
+		m_pattern->add_point(0, value);
+		m_pattern->add_curve(time, id);
+		return true;
+	}
+};
@@ -0,0 +1,320 @@
+#pragma once
+
+// Compiled AHAP patterns. A binary file holds the arrays of a haptic_pattern_view back to back, so
+// loading one is a memory map plus a bounds check, with no parsing and no copies: the view points
+// straight into the mapping.
+//
+// Layout: an ahap_binary_header, then every column of the view in the order of for_each_column,
+// each starting at a multiple of 8 bytes. Values are stored in host byte order, a file written on a
+// host of the other byte order is rejected.
+
+#include "ahap.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+inline constexpr char AhapBinaryMagic[4] = { 'A', 'H', 'P', 'B' };
+inline constexpr uint32_t AhapBinaryFormat = 1;
+inline constexpr uint32_t AhapBinaryByteOrder = 0x01020304;
+
+struct ahap_binary_header {
+	char magic[4];
+	uint32_t format;
+	uint32_t byte_order;
+	uint32_t string_count;
+	uint32_t string_bytes;
+	uint32_t metadata_count;
+	uint32_t event_count;
+	uint32_t parameter_count;
+	uint32_t curve_count;
+	uint32_t point_count;
+	double version;
+	uint64_t size;			// of the whole file
+};
+static_assert(sizeof(ahap_binary_header) == 56, "the header is written as is and must not contain padding");
+
+enum class ahap_binary_error {
+	none,
+	cannot_open,
+	truncated,
+	bad_magic,
+	unsupported_format,
+	corrupt,
+};
+
+inline const char* describe(ahap_binary_error error) {
+	switch (error) {
+	case ahap_binary_error::none: return "no error";
+	case ahap_binary_error::cannot_open: return "cannot open file";
+	case ahap_binary_error::truncated: return "file is truncated";
+	case ahap_binary_error::bad_magic: return "not a binary AHAP file";
+	case ahap_binary_error::unsupported_format: return "unsupported format version or byte order";
+	case ahap_binary_error::corrupt: return "offsets or enum values out of range";
+	}
+	return "unknown error";
+}
+
+// Calls fn(column, count) for every column of view in file order, count being the number of
+// elements the header gives the column
+template<class Fn>
+void for_each_column(haptic_pattern_view& view, const ahap_binary_header& header, Fn&& fn) {
+	fn(view.strings, size_t(header.string_bytes));
+	fn(view.string_offsets, size_t(header.string_count) + 1);
+	fn(view.metadata, size_t(header.metadata_count) * 2);
+	fn(view.event_time, size_t(header.event_count));
+	fn(view.event_duration, size_t(header.event_count));
+	fn(view.event_waveform, size_t(header.event_count));
+	fn(view.event_parameters, size_t(header.event_count) + 1);
+	fn(view.event_type, size_t(header.event_count));
+	fn(view.parameter_value, size_t(header.parameter_count));
+	fn(view.parameter_id, size_t(header.parameter_count));
+	fn(view.curve_time, size_t(header.curve_count));
+	fn(view.curve_points, size_t(header.curve_count) + 1);
+	fn(view.curve_id, size_t(header.curve_count));
+	fn(view.point_time, size_t(header.point_count));
+	fn(view.point_value, size_t(header.point_count));
+}
+
+inline constexpr size_t align_column(size_t offset) {
+	return (offset + 7) & ~size_t(7);
+}
+
+// Encodes a view of a HapticPattern (or of another binary file) into out
+inline void write_ahap_binary(const haptic_pattern_view& view, std::string& out) {
+	ahap_binary_header header{};
+	std::memcpy(header.magic, AhapBinaryMagic, sizeof(header.magic));
+	header.format = AhapBinaryFormat;
+	header.byte_order = AhapBinaryByteOrder;
+	header.string_count = static_cast<uint32_t>(view.string_offsets.size() - 1);
+	header.string_bytes = static_cast<uint32_t>(view.strings.size());
+	header.metadata_count = static_cast<uint32_t>(view.metadata_count());
+	header.event_count = static_cast<uint32_t>(view.event_count());
+	header.parameter_count = static_cast<uint32_t>(view.parameter_id.size());
+	header.curve_count = static_cast<uint32_t>(view.curve_count());
+	header.point_count = static_cast<uint32_t>(view.point_time.size());
+	header.version = view.version;
+
+	out.assign(sizeof(header), '\0');
+	auto columns = view;
+	for_each_column(columns, header, [&](auto& column, size_t count) {
+		out.resize(align_column(out.size()), '\0');
+		if (count > 0) {
+			out.append(reinterpret_cast<const char*>(column.data()), count * sizeof(column[0]));
+		}
+		});
+	header.size = out.size();
+	std::memcpy(out.data(), &header, sizeof(header));
+}
+
+inline bool save_ahap_binary(const haptic_pattern_view& view, const char* path) {
+	std::string bytes;
+	write_ahap_binary(view, bytes);
+	std::ofstream ofs(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	ofs.write(bytes.data(), bytes.size());
+	return ofs.good();
+}
+
+// Offset arrays start at 0, never decrease and end at the size of the array they index into
+inline bool valid_offsets(span<const uint32_t> offsets, size_t total) {
+	if (offsets.front() != 0 || offsets.back() != total) {
+		return false;
+	}
+	for (size_t i = 1; i < offsets.size(); i++) {
+		if (offsets[i] < offsets[i - 1]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<class Enum, size_t N>
+bool valid_enums(span<const Enum> values, const char* const (&)[N]) {
+	return std::all_of(values.begin(), values.end(), [](Enum e) { return static_cast<size_t>(e) < N; });
+}
+
+// Views a binary pattern in place. data must be 8-byte aligned, as mapped files and heap blocks are,
+// and outlive the view. Every offset and enum is checked, so a damaged file cannot make the view
+// read out of bounds.
+inline expected<haptic_pattern_view, ahap_binary_error> read_ahap_binary(const void* data, size_t size) {
+	const auto* bytes = static_cast<const char*>(data);
+	ahap_binary_header header;
+	if (size < sizeof(header) || reinterpret_cast<uintptr_t>(bytes) % 8 != 0) {
+		return make_unexpected(ahap_binary_error::truncated);
+	}
+	std::memcpy(&header, bytes, sizeof(header));
+	if (std::memcmp(header.magic, AhapBinaryMagic, sizeof(header.magic)) != 0) {
+		return make_unexpected(ahap_binary_error::bad_magic);
+	}
+	if (header.format != AhapBinaryFormat || header.byte_order != AhapBinaryByteOrder) {
+		return make_unexpected(ahap_binary_error::unsupported_format);
+	}
+	if (header.size > size) {
+		return make_unexpected(ahap_binary_error::truncated);
+	}
+
+	haptic_pattern_view view;
+	view.version = header.version;
+	size_t offset = sizeof(header);
+	for_each_column(view, header, [&](auto& column, size_t count) {
+		using T = typename std::decay_t<decltype(column)>::value_type;
+		offset = align_column(offset);
+		column = { reinterpret_cast<const T*>(bytes + offset), count };
+		offset += count * sizeof(T);
+		});
+	if (offset != header.size) {
+		return make_unexpected(offset > header.size ? ahap_binary_error::truncated : ahap_binary_error::corrupt);
+	}
+
+	const auto strings = header.string_count;
+	const bool valid = valid_offsets(view.string_offsets, view.strings.size()) &&
+		valid_offsets(view.event_parameters, view.parameter_id.size()) &&
+		valid_offsets(view.curve_points, view.point_time.size()) &&
+		std::all_of(view.metadata.begin(), view.metadata.end(), [&](uint32_t s) { return s < strings; }) &&
+		std::all_of(view.event_waveform.begin(), view.event_waveform.end(), [&](int32_t s) { return s >= -1 && s < int64_t(strings); }) &&
+		valid_enums(view.event_type, HapticEventTypeNames) &&
+		valid_enums(view.parameter_id, HapticEventParameterNames) &&
+		valid_enums(view.curve_id, HapticDynamicParameterNames);
+	if (!valid) {
+		return make_unexpected(ahap_binary_error::corrupt);
+	}
+	return view;
+}
+
+// Read-only mapping of a whole file
+class MappedFile
+{
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+	MappedFile& operator=(MappedFile&& other) noexcept
+	{
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		return *this;
+	}
+
+	~MappedFile()
+	{
+		Close();
+	}
+
+	const char* Data() const { return m_data; }
+	size_t Size() const { return m_size; }
+
+	// An empty file opens with no data
+	bool Open(const char* path)
+	{
+		Close();
+#if defined(_WIN32)
+		const HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER size;
+		bool ok = GetFileSizeEx(file, &size) != 0;
+		if (ok && size.QuadPart > 0) {
+			const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			if (mapping) {
+				CloseHandle(mapping);
+			}
+			ok = data != nullptr;
+			m_data = static_cast<const char*>(data);
+			m_size = ok ? static_cast<size_t>(size.QuadPart) : 0;
+		}
+		CloseHandle(file);
+		return ok;
+#else
+		const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat st;
+		bool ok = ::fstat(fd, &st) == 0;
+		if (ok && st.st_size > 0) {
+			// Loading reads every page right away, fault them in with the mapping
+			int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+			flags |= MAP_POPULATE;
+#endif
+			void* data = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, flags, fd, 0);
+			ok = data != MAP_FAILED;
+			if (ok) {
+				m_data = static_cast<const char*>(data);
+				m_size = static_cast<size_t>(st.st_size);
+			}
+		}
+		::close(fd);
+		return ok;
+#endif
+	}
+
+	void Close()
+	{
+		if (m_data) {
+#if defined(_WIN32)
+			UnmapViewOfFile(m_data);
+#else
+			::munmap(const_cast<char*>(m_data), m_size);
+#endif
+		}
+		m_data = nullptr;
+		m_size = 0;
+	}
+};
+
+// A binary pattern file mapped into memory. The view stays valid while the file is open, moving
+// the file does not move the mapping.
+class ahap_binary_file
+{
+	MappedFile m_file;
+	haptic_pattern_view m_view;
+	ahap_binary_error m_error = ahap_binary_error::none;
+
+public:
+	ahap_binary_file() = default;
+
+	// False with error() set if the file cannot be mapped or is not a valid binary pattern
+	bool open(const char* path) {
+		m_view = {};
+		if (!m_file.Open(path)) {
+			m_error = ahap_binary_error::cannot_open;
+			return false;
+		}
+		auto view = read_ahap_binary(m_file.Data(), m_file.Size());
+		if (!view) {
+			m_error = view.error();
+			m_file.Close();
+			return false;
+		}
+		m_view = *view;
+		m_error = ahap_binary_error::none;
+		return true;
+	}
+
+	void close() {
+		m_view = {};
+		m_file.Close();
+	}
+
+	bool is_open() const { return m_file.Data() != nullptr; }
+	const haptic_pattern_view& view() const { return m_view; }
+	ahap_binary_error error() const { return m_error; }
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+// Renders dynamic parameters into dense buffers at a fixed sample rate. Rather than searching the
+// control points for every sample, each segment between two points is found once and filled as a
+// ramp a + b * j, a vector of samples per step, so the cost is one multiply-add per sample.
+
+#include "ahap_timeline.h"
+
+// out[j] = a + b * j for j in [0, count)
+inline void render_ramp(float a, float b, float* out, size_t count) {
+	size_t j = 0;
+#if defined(JPARSER_AVX2)
+	const auto base = _mm256_set1_ps(a), slope = _mm256_set1_ps(b), step = _mm256_set1_ps(8);
+	auto index = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+	for (; j + 8 <= count; j += 8) {
+		_mm256_storeu_ps(out + j, _mm256_add_ps(base, _mm256_mul_ps(slope, index)));
+		index = _mm256_add_ps(index, step);
+	}
+#elif defined(JPARSER_SSE2)
+	const auto base = _mm_set1_ps(a), slope = _mm_set1_ps(b), step = _mm_set1_ps(4);
+	auto index = _mm_setr_ps(0, 1, 2, 3);
+	for (; j + 4 <= count; j += 4) {
+		_mm_storeu_ps(out + j, _mm_add_ps(base, _mm_mul_ps(slope, index)));
+		index = _mm_add_ps(index, step);
+	}
+#endif
+	for (; j < count; j++) {
+		out[j] = a + b * static_cast<float>(j);
+	}
+}
+
+// Samples a track at start, start + 1 / sample_rate, ... into out[0, count), with the same rules as
+// interpolate: fallback before the first point, the last value after the last
+inline void render_track(haptic_track track, float start, float sample_rate, float fallback, float* out, size_t count) {
+	const double step = 1.0 / sample_rate;
+	// First sample at or after time
+	const auto sample_at = [&](float time) {
+		const double index = std::ceil((double(time) - start) * sample_rate);
+		return index <= 0 ? size_t(0) : (std::min)(count, static_cast<size_t>(index));
+	};
+	if (track.times.empty()) {
+		std::fill_n(out, count, fallback);
+		return;
+	}
+	size_t s = sample_at(track.times[0]);
+	std::fill_n(out, s, fallback);
+	for (size_t i = 0; i + 1 < track.times.size() && s < count; i++) {
+		const size_t e = sample_at(track.times[i + 1]);
+		if (e <= s) {
+			continue;
+		}
+		// Anchored at the segment's first sample, so long buffers keep their precision
+		const double slope = (double(track.values[i + 1]) - track.values[i]) / (double(track.times[i + 1]) - track.times[i]);
+		const double offset = start + s * step - track.times[i];
+		render_ramp(static_cast<float>(track.values[i] + slope * offset), static_cast<float>(slope * step), out + s, e - s);
+		s = e;
+	}
+	std::fill_n(out + s, count - s, track.values.back());
+}
+
+// Samples needed to cover a curve through its last control point
+inline size_t curve_sample_count(const haptic_curve& curve, float sample_rate) {
+	return curve.point_times.empty() ? 0 : static_cast<size_t>(std::floor(double(curve.point_times.back()) * sample_rate)) + 1;
+}
+
+// Sample 0 is the start of the curve. The first value holds until the first control point.
+inline void render_curve(const haptic_curve& curve, float sample_rate, float* out, size_t count) {
+	const float first = curve.point_values.empty() ? 0 : curve.point_values[0];
+	render_track({ curve.point_times, curve.point_values }, 0, sample_rate, first, out, count);
+}
+
+// Renders every curve of the pattern through its last control point: the samples of curve i are
+// samples[offsets[i], offsets[i + 1]). Both vectors are overwritten.
+inline void render_curves(const haptic_pattern_view& pattern, float sample_rate, std::vector<float>& samples, std::vector<uint32_t>& offsets) {
+	offsets.assign(1, 0);
+	for (size_t i = 0; i < pattern.curve_count(); i++) {
+		offsets.push_back(offsets.back() + static_cast<uint32_t>(curve_sample_count(pattern.curve(i), sample_rate)));
+	}
+	samples.resize(offsets.back());
+	for (size_t i = 0; i < pattern.curve_count(); i++) {
+		render_curve(pattern.curve(i), sample_rate, samples.data() + offsets[i], offsets[i + 1] - offsets[i]);
+	}
+}
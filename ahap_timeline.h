@@ -0,0 +1,249 @@
+#pragma once
+
+// Time index over a haptic pattern, for playback that asks what is active in a window [begin, end).
+// Events are sorted by start time and carry an implicit interval tree: the sorted array is read as a
+// balanced binary tree (node i at level k has children i -/+ 2^(k-1)) where every node also stores
+// the latest end time of its subtree, so a query visits O(log n + k) nodes instead of every event.
+// Dynamic parameters become one piecewise-linear track per parameter ID, with a later curve taking
+// over from the point where it starts.
+
+#include "ahap.h"
+
+struct haptic_window {
+	float begin;
+	float end;
+};
+
+// Control points of one dynamic parameter in absolute time, ascending
+struct haptic_track {
+	span<const float> times;
+	span<const float> values;
+};
+
+// Linear interpolation between the points around time; fallback before the first point, the last
+// value after the last
+inline float interpolate(haptic_track track, float time, float fallback) {
+	const auto i = static_cast<size_t>(std::upper_bound(track.times.begin(), track.times.end(), time) - track.times.begin());
+	if (i == 0) {
+		return fallback;
+	}
+	if (i == track.times.size()) {
+		return track.values.back();
+	}
+	const float t0 = track.times[i - 1], t1 = track.times[i];
+	return track.values[i - 1] + (track.values[i] - track.values[i - 1]) * ((time - t0) / (t1 - t0));
+}
+
+// Refers to the arrays of the pattern it was built from, which must outlive it. Queries do not
+// allocate once the output vectors have grown to their working size, so they suit an audio thread.
+class HapticTimeline
+{
+	static constexpr size_t ParameterCount = std::size(HapticDynamicParameterNames);
+
+	haptic_pattern_view m_pattern;
+	std::vector<float> m_start;		// events by start time
+	std::vector<float> m_end;
+	std::vector<float> m_maxEnd;	// latest end in the subtree of each node
+	std::vector<uint32_t> m_event;	// index into the pattern
+	int m_rootLevel = -1;
+	std::vector<float> m_trackTime;
+	std::vector<float> m_trackValue;
+	std::vector<uint32_t> m_tracks = std::vector<uint32_t>(ParameterCount + 1, 0);	// points of parameter ID i are [m_tracks[i], m_tracks[i + 1])
+
+public:
+	HapticTimeline() = default;
+	explicit HapticTimeline(const haptic_pattern_view& pattern) { build(pattern); }
+
+	void build(const haptic_pattern_view& pattern) {
+		m_pattern = pattern;
+		build_events();
+		build_tracks();
+	}
+
+	const haptic_pattern_view& pattern() const { return m_pattern; }
+
+	// Events that start before end and are still running at begin, or start inside the window.
+	// Appends their pattern indices to out, ordered by start time, and returns how many there were.
+	size_t events_in(float begin, float end, std::vector<uint32_t>& out) const {
+		const auto count = out.size();
+		if (m_rootLevel < 0) {
+			return 0;
+		}
+		const size_t n = m_start.size();
+		const auto active = [&](size_t i) { return m_start[i] >= begin || m_end[i] > begin; };
+		// Top-down walk that finishes each left subtree before its node, so output stays sorted.
+		// Subtrees of up to 16 nodes are scanned linearly.
+		struct cell {
+			int level;
+			size_t node;
+			bool left_done;
+		};
+		cell stack[64];
+		int top = 0;
+		stack[top++] = { m_rootLevel, (size_t(1) << m_rootLevel) - 1, false };
+		while (top > 0) {
+			const cell c = stack[--top];
+			if (c.level <= 3) {
+				const size_t first = c.node >> c.level << c.level;
+				const size_t last = (std::min)(first + (size_t(1) << (c.level + 1)) - 1, n);
+				for (size_t i = first; i < last && m_start[i] < end; i++) {
+					if (active(i)) {
+						out.push_back(m_event[i]);
+					}
+				}
+			}
+			else if (!c.left_done) {
+				const size_t left = c.node - (size_t(1) << (c.level - 1));
+				stack[top++] = { c.level, c.node, true };
+				if (left >= n || m_maxEnd[left] >= begin) {
+					stack[top++] = { c.level - 1, left, false };
+				}
+			}
+			else if (c.node < n && m_start[c.node] < end) {
+				if (active(c.node)) {
+					out.push_back(m_event[c.node]);
+				}
+				stack[top++] = { c.level - 1, c.node + (size_t(1) << (c.level - 1)), false };
+			}
+		}
+		return out.size() - count;
+	}
+
+	// events_in for every window at once: the events of window i are
+	// events[offsets[i], offsets[i + 1]). Both vectors are cleared first.
+	void events_in(span<const haptic_window> windows, std::vector<uint32_t>& events, std::vector<uint32_t>& offsets) const {
+		events.clear();
+		offsets.assign(1, 0);
+		for (const auto& w : windows) {
+			events_in(w.begin, w.end, events);
+			offsets.push_back(static_cast<uint32_t>(events.size()));
+		}
+	}
+
+	haptic_track track(haptic_dynamic_parameter id) const {
+		const auto i = static_cast<size_t>(id);
+		const auto first = m_tracks[i], count = m_tracks[i + 1] - first;
+		return { { m_trackTime.data() + first, count }, { m_trackValue.data() + first, count } };
+	}
+
+	// Control points of the parameter that fall inside [begin, end)
+	haptic_track points_in(haptic_dynamic_parameter id, float begin, float end) const {
+		const auto all = track(id);
+		const auto first = std::lower_bound(all.times.begin(), all.times.end(), begin) - all.times.begin();
+		const auto last = std::lower_bound(all.times.begin() + first, all.times.end(), end) - all.times.begin();
+		return { all.times.subspan(first, last - first), all.values.subspan(first, last - first) };
+	}
+
+	// Value of the parameter at time, fallback before its first control point
+	float value(haptic_dynamic_parameter id, float time, float fallback) const {
+		return interpolate(track(id), time, fallback);
+	}
+
+	// value for a batch of times. Ascending times advance through the track without searching it again.
+	void values(haptic_dynamic_parameter id, span<const float> times, float* out, float fallback) const {
+		const auto all = track(id);
+		const size_t n = all.times.size();
+		size_t i = 0;
+		float previous = -INFINITY;
+		for (size_t s = 0; s < times.size(); s++) {
+			const float t = times[s];
+			if (t < previous) {
+				i = std::upper_bound(all.times.begin(), all.times.end(), t) - all.times.begin();
+			}
+			while (i < n && all.times[i] <= t) {
+				i++;
+			}
+			previous = t;
+			if (i == 0) {
+				out[s] = fallback;
+			}
+			else if (i == n) {
+				out[s] = all.values[n - 1];
+			}
+			else {
+				const float t0 = all.times[i - 1], t1 = all.times[i];
+				out[s] = all.values[i - 1] + (all.values[i] - all.values[i - 1]) * ((t - t0) / (t1 - t0));
+			}
+		}
+	}
+
+private:
+	void build_events() {
+		const size_t n = m_pattern.event_count();
+		m_event.resize(n);
+		for (size_t i = 0; i < n; i++) {
+			m_event[i] = static_cast<uint32_t>(i);
+		}
+		std::stable_sort(m_event.begin(), m_event.end(), [&](uint32_t a, uint32_t b) { return m_pattern.event_time[a] < m_pattern.event_time[b]; });
+		m_start.resize(n);
+		m_end.resize(n);
+		for (size_t i = 0; i < n; i++) {
+			m_start[i] = m_pattern.event_time[m_event[i]];
+			m_end[i] = m_start[i] + (std::max)(m_pattern.event_duration[m_event[i]], 0.0f);
+		}
+		m_maxEnd = m_end;
+		m_rootLevel = -1;
+		if (n == 0) {
+			return;
+		}
+		// Leaves are the even indices; the rightmost path may point past the end of the array, last
+		// tracks the latest end below it so such nodes still get a correct bound
+		size_t lastIndex = (n - 1) & ~size_t(1);
+		float last = m_maxEnd[lastIndex];
+		int level = 1;
+		for (; (size_t(1) << level) <= n; level++) {
+			const size_t half = size_t(1) << (level - 1);
+			for (size_t i = (half << 1) - 1; i < n; i += half << 2) {
+				const float right = i + half < n ? m_maxEnd[i + half] : last;
+				m_maxEnd[i] = (std::max)({ m_end[i], m_maxEnd[i - half], right });
+			}
+			lastIndex = (lastIndex >> level & 1) ? lastIndex - half : lastIndex + half;
+			if (lastIndex < n && m_maxEnd[lastIndex] > last) {
+				last = m_maxEnd[lastIndex];
+			}
+		}
+		m_rootLevel = level - 1;
+	}
+
+	void build_tracks() {
+		std::vector<uint32_t> curves(m_pattern.curve_count());
+		for (size_t i = 0; i < curves.size(); i++) {
+			curves[i] = static_cast<uint32_t>(i);
+		}
+		std::stable_sort(curves.begin(), curves.end(), [&](uint32_t a, uint32_t b) {
+			return m_pattern.curve_id[a] != m_pattern.curve_id[b] ? m_pattern.curve_id[a] < m_pattern.curve_id[b] : m_pattern.curve_time[a] < m_pattern.curve_time[b];
+			});
+		m_trackTime.clear();
+		m_trackValue.clear();
+		m_tracks.assign(ParameterCount + 1, 0);
+		auto next = curves.begin();
+		for (size_t id = 0; id < ParameterCount; id++) {
+			const auto first = m_trackTime.size();
+			for (; next != curves.end() && static_cast<size_t>(m_pattern.curve_id[*next]) == id; ++next) {
+				const auto curve = m_pattern.curve(*next);
+				if (curve.point_times.empty()) {
+					continue;
+				}
+				// Cut the track where this curve starts, keeping its value there
+				const float start = curve.time + curve.point_times[0];
+				if (m_trackTime.size() > first && m_trackTime.back() > start) {
+					const haptic_track soFar{ { m_trackTime.data() + first, m_trackTime.size() - first }, { m_trackValue.data() + first, m_trackValue.size() - first } };
+					const float cut = interpolate(soFar, start, 0);
+					while (m_trackTime.size() > first && m_trackTime.back() > start) {
+						m_trackTime.pop_back();
+						m_trackValue.pop_back();
+					}
+					m_trackTime.push_back(start);
+					m_trackValue.push_back(cut);
+				}
+				for (size_t p = 0; p < curve.point_times.size(); p++) {
+					// Out-of-order points are clamped so the track stays sorted
+					const float time = curve.time + curve.point_times[p];
+					m_trackTime.push_back(m_trackTime.size() > first ? (std::max)(time, m_trackTime.back()) : time);
+					m_trackValue.push_back(curve.point_values[p]);
+				}
+			}
+			m_tracks[id + 1] = static_cast<uint32_t>(m_trackTime.size());
+		}
+	}
+};
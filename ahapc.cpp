@@ -0,0 +1,86 @@
+// ahapc.cpp : Compiles AHAP files into the binary format of ahap_binary.h.
+//
+// usage: jparser_ahapc [-o DIR] FILE.ahap...
+//
+// Each FILE.ahap becomes FILE.ahapb, next to its source or in DIR. Every output is mapped back and
+// checked against the decoded pattern before the next file is compiled.
+
+#include "ahap_binary.h"
+#include <filesystem>
+
+// The arrays of two views hold the same bytes
+bool same_pattern(haptic_pattern_view a, haptic_pattern_view b) {
+	bool same = a.version == b.version;
+	ahap_binary_header header{};
+	std::vector<std::pair<const void*, size_t>> columns;
+	for_each_column(a, header, [&](auto& column, size_t) {
+		columns.emplace_back(column.data(), column.size() * sizeof(column[0]));
+		});
+	auto next = columns.begin();
+	for_each_column(b, header, [&](auto& column, size_t) {
+		const auto bytes = column.size() * sizeof(column[0]);
+		same = same && next->second == bytes && (bytes == 0 || std::memcmp(next->first, column.data(), bytes) == 0);
+		++next;
+		});
+	return same;
+}
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path outputDir;
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; i++) {
+		const std::string_view arg = argv[i];
+		if (arg == "-o" && i + 1 < argc) {
+			outputDir = argv[++i];
+		}
+		else if (!arg.empty() && arg[0] != '-') {
+			inputs.emplace_back(arg);
+		}
+		else {
+			inputs.clear();
+			break;
+		}
+	}
+	if (inputs.empty()) {
+		std::cerr << "usage: jparser_ahapc [-o DIR] FILE.ahap..." << std::endl;
+		return 2;
+	}
+
+	int failures = 0;
+	HapticPattern pattern;
+	ahap_binary_file compiled;
+	for (const auto& input : inputs) {
+		auto output = outputDir.empty() ? input : outputDir / input.filename();
+		output.replace_extension(".ahapb");
+		std::ifstream ifs(input, std::ios::in | std::ios::binary);
+		if (!ifs) {
+			std::cout << "error    " << input.string() << ": cannot open file" << std::endl;
+			failures++;
+			continue;
+		}
+		ahap_parser decoder(std::string{ std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{} });
+		if (!decoder.decode(pattern)) {
+			std::cout << "error    " << input.string() << ": " << decoder.error() << std::endl;
+			failures++;
+			continue;
+		}
+		if (!save_ahap_binary(pattern.view(), output.string().c_str())) {
+			std::cout << "error    " << output.string() << ": cannot write file" << std::endl;
+			failures++;
+			continue;
+		}
+		if (!compiled.open(output.string().c_str())) {
+			std::cout << "error    " << output.string() << ": " << describe(compiled.error()) << std::endl;
+			failures++;
+			continue;
+		}
+		const bool same = same_pattern(pattern.view(), compiled.view());
+		std::cout << (same ? "ok       " : "mismatch ") << output.string() << ": " << pattern.view().event_count() << " events, "
+			<< pattern.view().curve_count() << " curves, " << std::filesystem::file_size(input) << " -> " << std::filesystem::file_size(output)
+			<< " bytes" << std::endl;
+		failures += !same;
+		compiled.close();
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,1101 @@
+// bench.cpp : Benchmark suite. Every file of the data directory is timed separately for parsing,
+// DOM traversal, serialization and the full round trip, so a regression shows up in its own stage.
+//
+// usage: jparser_bench [--data DIR] [--filter TEXT] [--min-iters N] [--generate SHAPE:SIZE]...
+//                      [--export FILE.json|.csv|.html] [--compare BASELINE.json] [--tolerance PERCENT]
+//                      [--threads MAX [--seconds S]]
+//
+// --generate adds a synthetic document from generator.h to the corpus, e.g. --generate numbers:64M,
+// to see how a stage scales with input size. --data none leaves out the data directory.
+//
+// --export renders the results through nanobench's templates. A JSON export is also the baseline format:
+// --compare loads one and exits with 1 if any stage of any file got significantly slower.
+//
+// On Linux the summary also lists hardware counters per stage: instructions per byte and IPC tell
+// how much work a stage does, branch and cache misses per KB whether it is branch- or memory-bound.
+// Where perf events are unavailable (other systems, VMs without a PMU, perf_event_paranoid > 2)
+// those columns print "-".
+//
+// --threads replaces the stage benchmarks with a scaling run: the corpus is parsed on 1, 2, 4... MAX
+// threads at once (0 = hardware concurrency), each thread with its own parsers and arena, reporting
+// aggregate throughput, parse latency percentiles and how close the scaling comes to linear. It needs
+// JPARSER_ARENA_THREAD_LOCAL, which the CMake target defines.
+//
+// Allocations are counted per run of each stage: heap allocations through a replaced global operator
+// new, arena allocations through g_arena's counters.
+//
+// "parse packed" repeats the parse with parse_options::pack_numbers, "parse lazy" with
+// lazy_numbers and lazy_strings.
+//
+// twitter.json and citm_catalog.json also get a "typed decode" stage into the structs below, through
+// json_struct_parser (json_bind.h) with no DOM in between, and a "typed encode" stage writing the
+// decoded structs back out with write_typed. Both count input bytes, and the models leave members
+// out, so set typed encode against serialize as time per document rather than as throughput.
+//
+// .ahap files get five more stages: the typed decoder, the same pattern extracted from the DOM,
+// building a timeline and sweeping it in playback-sized windows, rendering every curve at 48 kHz,
+// and loading the pattern compiled to the binary format of ahap_binary.h.
+
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include "nanobench.h"
+#include "jparser.h"
+#include "generator.h"
+#include "json_bind.h"
+#include "ahap.h"
+#include "ahap_binary.h"
+#include "ahap_render.h"
+#include <filesystem>
+#include <atomic>
+#include <iomanip>
+#include <optional>
+#include <thread>
+
+#if ANKERL_NANOBENCH(PERF_COUNTERS)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifndef JPARSER_DATA_DIR
+#define JPARSER_DATA_DIR "data"
+#endif
+
+// Heap allocations of the current thread. Over-aligned new keeps the default implementation
+// and is not counted; nothing in the DOM uses it.
+struct heap_counters {
+	uint64_t allocs = 0;
+	uint64_t bytes = 0;
+};
+
+thread_local heap_counters g_heap;
+
+// Every replaced operator below allocates and frees through these two. They stay out of line, so
+// GCC never sees free() applied to the result of operator new and warns of a mismatch.
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void* counted_alloc(std::size_t size) noexcept {
+	g_heap.allocs++;
+	g_heap.bytes += size;
+	return std::malloc(size ? size : 1);
+}
+
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+void counted_free(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void* operator new(std::size_t size) {
+	if (void* ptr = counted_alloc(size)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return counted_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return counted_alloc(size);
+}
+
+void operator delete(void* ptr) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr) noexcept { counted_free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { counted_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { counted_free(ptr); }
+
+// Allocations made by one call of a stage
+struct alloc_stats {
+	uint64_t heap_allocs = 0;
+	uint64_t heap_bytes = 0;
+	uint64_t arena_allocs = 0;
+	uint64_t arena_bytes = 0;
+};
+
+template<typename Fn>
+alloc_stats count_allocations(Fn&& fn) {
+	const auto heap = g_heap;
+	const auto arenaAllocs = g_arena.AllocCount();
+	const auto arenaBytes = g_arena.AllocBytes();
+	fn();
+	return { g_heap.allocs - heap.allocs, g_heap.bytes - heap.bytes, g_arena.AllocCount() - arenaAllocs, g_arena.AllocBytes() - arenaBytes };
+}
+
+struct corpus_file {
+	std::string name;
+	std::string text;
+};
+
+struct bench_options {
+	std::string data = JPARSER_DATA_DIR;
+	std::string filter;
+	uint64_t min_iters = 10;
+	std::vector<gen_options> generate;
+	std::string export_file;
+	std::string compare_file;
+	double tolerance = 0.03;	// slowdowns below this fraction are never reported
+	bool threaded = false;
+	size_t max_threads = 0;		// 0 means std::thread::hardware_concurrency()
+	double seconds = 1;			// duration of each thread count
+};
+
+// One line of the summary: how fast a stage processed one file
+struct stage_result {
+	std::string file;
+	std::string stage;
+	size_t bytes;
+	double seconds_per_doc;		// median over epochs
+	double error;				// nanobench's median absolute percent error, as a fraction
+	std::vector<double> samples;	// seconds per doc of every epoch
+	// Hardware counters per doc, empty where perf events are unavailable
+	std::optional<double> instructions;
+	std::optional<double> cycles;
+	std::optional<double> branch_misses;
+	std::optional<double> cache_misses;
+	alloc_stats allocs;
+};
+
+// nanobench counts instructions, cycles and branches but not the cache, so last level cache misses
+// get their own perf event. Counts user space only, like nanobench does.
+class cache_miss_counter {
+public:
+	cache_miss_counter() {
+#if ANKERL_NANOBENCH(PERF_COUNTERS)
+		perf_event_attr pea{};
+		pea.type = PERF_TYPE_HARDWARE;
+		pea.size = sizeof(pea);
+		pea.config = PERF_COUNT_HW_CACHE_MISSES;
+		pea.disabled = 1;
+		pea.exclude_kernel = 1;
+		pea.exclude_hv = 1;
+		m_fd = static_cast<int>(syscall(__NR_perf_event_open, &pea, 0, -1, -1, 0));
+#endif
+	}
+	~cache_miss_counter() {
+#if ANKERL_NANOBENCH(PERF_COUNTERS)
+		if (m_fd != -1) {
+			close(m_fd);
+		}
+#endif
+	}
+	cache_miss_counter(const cache_miss_counter&) = delete;
+	cache_miss_counter& operator=(const cache_miss_counter&) = delete;
+
+	bool Available() const { return m_fd != -1; }
+
+	// Median misses per call of fn over a few rounds of iters calls each
+	template<typename Fn>
+	std::optional<double> Measure(Fn&& fn, uint64_t iters) {
+		if (!Available()) {
+			return std::nullopt;
+		}
+		std::vector<double> rounds;
+		for (int round = 0; round < 5; round++) {
+			const auto misses = Count(fn, iters);
+			if (!misses) {
+				return std::nullopt;
+			}
+			rounds.push_back(static_cast<double>(*misses) / iters);
+		}
+		std::nth_element(rounds.begin(), rounds.begin() + rounds.size() / 2, rounds.end());
+		return rounds[rounds.size() / 2];
+	}
+
+private:
+	template<typename Fn>
+	std::optional<uint64_t> Count([[maybe_unused]] Fn& fn, [[maybe_unused]] uint64_t iters) {
+#if ANKERL_NANOBENCH(PERF_COUNTERS)
+		uint64_t misses = 0;
+		ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+		for (uint64_t i = 0; i < iters; i++) {
+			fn();
+		}
+		ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(m_fd, &misses, sizeof(misses)) == sizeof(misses)) {
+			return misses;
+		}
+#endif
+		return std::nullopt;
+	}
+
+	int m_fd = -1;
+};
+
+std::vector<corpus_file> load_corpus(const bench_options& options) {
+	std::vector<corpus_file> corpus;
+	if (options.data != "none") {
+		for (const auto& entry : std::filesystem::directory_iterator(options.data)) {
+			const auto name = entry.path().filename().string();
+			if (!entry.is_regular_file() || name.find(options.filter) == std::string::npos) {
+				continue;
+			}
+			std::ifstream ifs(entry.path(), std::ios::in | std::ios::binary);
+			corpus.push_back({ name, std::string{ std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{} } });
+		}
+		std::sort(corpus.begin(), corpus.end(), [](const corpus_file& a, const corpus_file& b) { return a.name < b.name; });
+	}
+	// Generated documents follow in command line order, named after their shape and size
+	json_writer writer;
+	for (const auto& gen : options.generate) {
+		generate_json(writer, gen);
+		corpus.push_back({ std::string("gen-") + shape_name(gen.shape) + "-" + std::to_string(gen.bytes), std::string(writer.view()) });
+	}
+	return corpus;
+}
+
+// Touches every value once, the access pattern of a consumer that reads the whole document
+struct traverse_stats {
+	size_t values = 0;
+	size_t text_bytes = 0;
+	double sum = 0;
+};
+
+void traverse(const job& value, traverse_stats& stats) {
+	stats.values++;
+	std::visit(overloaded{
+		[&](JsonNumber number) { stats.sum += number; },
+		[&](JsonBoolean boolean) { stats.sum += boolean; },
+		[&](JsonString text) { stats.text_bytes += text.size(); },
+		[&](JsonNull) {},
+		[&](const JsonArray& array) {
+			for (const auto& e : array) {
+				traverse(e, stats);
+			}
+		},
+		[&](const JsonDict& dict) {
+			for (const auto& e : dict) {
+				stats.text_bytes += e.first.size();
+				traverse(e.second, stats);
+			}
+		},
+		[&](const JsonNumbers& numbers) {
+			stats.values += numbers.values.size();
+			for (const auto n : numbers.values) {
+				stats.sum += n;
+			}
+		},
+		[&](const JsonRawNumber& number) { stats.sum += number.to_double(); },
+		[&](const JsonRawString& text) { stats.text_bytes += text.value().size(); },
+		}, value.value);
+}
+
+// The generic route to a HapticPattern, the baseline for ahap_parser: build the DOM, then look
+// every member up in it
+bool ahap_from_dom(const job& doc, HapticPattern& pattern) {
+	pattern.clear();
+	const auto member = [](const job& value, JsonString key) -> const job* {
+		const auto* dict = std::get_if<JsonDict>(&value.value);
+		if (dict == nullptr) {
+			return nullptr;
+		}
+		const auto it = dict->find(key);
+		return it == dict->end() ? nullptr : &it->second;
+	};
+	const auto number = [](const job* value, float& out) {
+		const auto* n = value ? std::get_if<JsonNumber>(&value->value) : nullptr;
+		if (n) {
+			out = static_cast<float>(*n);
+		}
+		return n != nullptr;
+	};
+	const auto text = [](const job* value) {
+		const auto* s = value ? std::get_if<JsonString>(&value->value) : nullptr;
+		return s ? *s : JsonString();
+	};
+	const auto* version = member(doc, "Version");
+	const auto* entries = member(doc, "Pattern");
+	if (version == nullptr || entries == nullptr || !std::holds_alternative<JsonArray>(entries->value)) {
+		return false;
+	}
+	pattern.version = version->as<JsonNumber>();
+	if (const auto* metadata = member(doc, "Metadata"); metadata && std::holds_alternative<JsonDict>(metadata->value)) {
+		for (const auto& e : std::get<JsonDict>(metadata->value)) {
+			if (std::holds_alternative<JsonString>(e.second.value)) {
+				pattern.add_metadata(e.first, std::get<JsonString>(e.second.value));
+			}
+		}
+	}
+	for (const auto& entry : std::get<JsonArray>(entries->value)) {
+		if (const auto* e = member(entry, "Event")) {
+			float time, duration = 0;
+			haptic_event_type type;
+			if (!number(member(*e, "Time"), time) || !find_name(HapticEventTypeNames, text(member(*e, "EventType")), type)) {
+				return false;
+			}
+			number(member(*e, "EventDuration"), duration);
+			int32_t waveform = -1;
+			if (const auto path = text(member(*e, "EventWaveformPath")); !path.empty()) {
+				waveform = static_cast<int32_t>(pattern.add_string(path));
+			}
+			if (const auto* parameters = member(*e, "EventParameters"); parameters && std::holds_alternative<JsonArray>(parameters->value)) {
+				for (const auto& p : std::get<JsonArray>(parameters->value)) {
+					haptic_event_parameter id;
+					float value;
+					if (!find_name(HapticEventParameterNames, text(member(p, "ParameterID")), id) || !number(member(p, "ParameterValue"), value)) {
+						return false;
+					}
+					pattern.add_parameter(id, value);
+				}
+			}
+			pattern.add_event(time, type, duration, waveform);
+		}
+		else if (const auto* c = member(entry, "ParameterCurve")) {
+			float time;
+			haptic_dynamic_parameter id;
+			if (!find_name(HapticDynamicParameterNames, text(member(*c, "ParameterID")), id) || !number(member(*c, "Time"), time)) {
+				return false;
+			}
+			if (const auto* points = member(*c, "ParameterCurveControlPoints"); points && std::holds_alternative<JsonArray>(points->value)) {
+				for (const auto& p : std::get<JsonArray>(points->value)) {
+					float pointTime, value;
+					if (!number(member(p, "Time"), pointTime) || !number(member(p, "ParameterValue"), value)) {
+						return false;
+					}
+					pattern.add_point(pointTime, value);
+				}
+			}
+			pattern.add_curve(time, id);
+		}
+		else if (const auto* d = member(entry, "Parameter")) {
+			float time, value;
+			haptic_dynamic_parameter id;
+			if (!find_name(HapticDynamicParameterNames, text(member(*d, "ParameterID")), id) || !number(member(*d, "Time"), time) ||
+				!number(member(*d, "ParameterValue"), value)) {
+				return false;
+			}
+			pattern.add_point(0, value);
+			pattern.add_curve(time, id);
+		}
+	}
+	return true;
+}
+
+// Typed models of twitter.json and citm_catalog.json for json_struct_parser, covering most members
+// a consumer would read; the rest is skipped
+struct twitter_hashtag {
+	JsonString text;
+	std::vector<int> indices;
+};
+JPARSER_FIELDS(twitter_hashtag, JPARSER_FIELD(text), JPARSER_FIELD(indices))
+
+struct twitter_url {
+	JsonString url;
+	JsonString expanded_url;
+	JsonString display_url;
+	std::vector<int> indices;
+};
+JPARSER_FIELDS(twitter_url, JPARSER_FIELD(url), JPARSER_FIELD(expanded_url), JPARSER_FIELD(display_url), JPARSER_FIELD(indices))
+
+struct twitter_mention {
+	JsonString screen_name;
+	JsonString name;
+	int64_t id;
+	std::vector<int> indices;
+};
+JPARSER_FIELDS(twitter_mention, JPARSER_FIELD(screen_name), JPARSER_FIELD(name), JPARSER_FIELD(id), JPARSER_FIELD(indices))
+
+struct twitter_entities {
+	std::vector<twitter_hashtag> hashtags;
+	std::vector<twitter_url> urls;
+	std::vector<twitter_mention> user_mentions;
+};
+JPARSER_FIELDS(twitter_entities, JPARSER_FIELD(hashtags), JPARSER_FIELD(urls), JPARSER_FIELD(user_mentions))
+
+struct twitter_user {
+	int64_t id;
+	JsonString name;
+	JsonString screen_name;
+	JsonString location;
+	JsonString description;
+	std::optional<JsonString> url;
+	bool is_protected;
+	int64_t followers_count;
+	int64_t friends_count;
+	int64_t listed_count;
+	JsonString created_at;
+	int64_t favourites_count;
+	std::optional<int> utc_offset;
+	std::optional<JsonString> time_zone;
+	bool verified;
+	int64_t statuses_count;
+	JsonString lang;
+	JsonString profile_image_url_https;
+};
+JPARSER_FIELDS(twitter_user, JPARSER_FIELD(id), JPARSER_FIELD(name), JPARSER_FIELD(screen_name), JPARSER_FIELD(location),
+	JPARSER_FIELD(description), JPARSER_FIELD(url), JPARSER_FIELD_AS(is_protected, "protected"), JPARSER_FIELD(followers_count),
+	JPARSER_FIELD(friends_count), JPARSER_FIELD(listed_count), JPARSER_FIELD(created_at), JPARSER_FIELD(favourites_count),
+	JPARSER_FIELD(utc_offset), JPARSER_FIELD(time_zone), JPARSER_FIELD(verified), JPARSER_FIELD(statuses_count), JPARSER_FIELD(lang),
+	JPARSER_FIELD(profile_image_url_https))
+
+struct twitter_status {
+	JsonString created_at;
+	int64_t id;
+	JsonString text;
+	JsonString source;
+	bool truncated;
+	std::optional<int64_t> in_reply_to_status_id;
+	std::optional<int64_t> in_reply_to_user_id;
+	std::optional<JsonString> in_reply_to_screen_name;
+	twitter_user user;
+	int64_t retweet_count;
+	int64_t favorite_count;
+	twitter_entities entities;
+	bool favorited;
+	bool retweeted;
+	std::optional<bool> possibly_sensitive;
+	JsonString lang;
+};
+JPARSER_FIELDS(twitter_status, JPARSER_FIELD(created_at), JPARSER_FIELD(id), JPARSER_FIELD(text), JPARSER_FIELD(source),
+	JPARSER_FIELD(truncated), JPARSER_FIELD(in_reply_to_status_id), JPARSER_FIELD(in_reply_to_user_id), JPARSER_FIELD(in_reply_to_screen_name),
+	JPARSER_FIELD(user), JPARSER_FIELD(retweet_count), JPARSER_FIELD(favorite_count), JPARSER_FIELD(entities), JPARSER_FIELD(favorited),
+	JPARSER_FIELD(retweeted), JPARSER_FIELD(possibly_sensitive), JPARSER_FIELD(lang))
+
+struct twitter_search_metadata {
+	double completed_in;
+	int64_t max_id;
+	JsonString query;
+	int count;
+	int64_t since_id;
+};
+JPARSER_FIELDS(twitter_search_metadata, JPARSER_FIELD(completed_in), JPARSER_FIELD(max_id), JPARSER_FIELD(query), JPARSER_FIELD(count),
+	JPARSER_FIELD(since_id))
+
+struct twitter_search {
+	std::vector<twitter_status> statuses;
+	twitter_search_metadata search_metadata;
+};
+JPARSER_FIELDS(twitter_search, JPARSER_FIELD(statuses), JPARSER_FIELD(search_metadata))
+
+struct citm_price {
+	int64_t amount;
+	int64_t audience_sub_category_id;
+	int64_t seat_category_id;
+};
+JPARSER_FIELDS(citm_price, JPARSER_FIELD(amount), JPARSER_FIELD_AS(audience_sub_category_id, "audienceSubCategoryId"),
+	JPARSER_FIELD_AS(seat_category_id, "seatCategoryId"))
+
+struct citm_area {
+	int64_t area_id;
+	std::vector<int64_t> block_ids;
+};
+JPARSER_FIELDS(citm_area, JPARSER_FIELD_AS(area_id, "areaId"), JPARSER_FIELD_AS(block_ids, "blockIds"))
+
+struct citm_seat_category {
+	std::vector<citm_area> areas;
+	int64_t seat_category_id;
+};
+JPARSER_FIELDS(citm_seat_category, JPARSER_FIELD(areas), JPARSER_FIELD_AS(seat_category_id, "seatCategoryId"))
+
+struct citm_performance {
+	int64_t event_id;
+	int64_t id;
+	std::optional<JsonString> logo;
+	std::optional<JsonString> name;
+	std::vector<citm_price> prices;
+	std::vector<citm_seat_category> seat_categories;
+	int64_t start;
+	JsonString venue_code;
+};
+JPARSER_FIELDS(citm_performance, JPARSER_FIELD_AS(event_id, "eventId"), JPARSER_FIELD(id), JPARSER_FIELD(logo), JPARSER_FIELD(name),
+	JPARSER_FIELD(prices), JPARSER_FIELD_AS(seat_categories, "seatCategories"), JPARSER_FIELD(start), JPARSER_FIELD_AS(venue_code, "venueCode"))
+
+struct citm_event {
+	int64_t id;
+	std::optional<JsonString> logo;
+	JsonString name;
+	std::vector<int64_t> sub_topic_ids;
+	std::vector<int64_t> topic_ids;
+};
+JPARSER_FIELDS(citm_event, JPARSER_FIELD(id), JPARSER_FIELD(logo), JPARSER_FIELD(name), JPARSER_FIELD_AS(sub_topic_ids, "subTopicIds"),
+	JPARSER_FIELD_AS(topic_ids, "topicIds"))
+
+struct citm_catalog {
+	std::map<JsonString, JsonString> area_names;
+	std::map<JsonString, JsonString> audience_sub_category_names;
+	std::map<JsonString, citm_event> events;
+	std::vector<citm_performance> performances;
+	std::map<JsonString, JsonString> seat_category_names;
+	std::map<JsonString, JsonString> sub_topic_names;
+	std::map<JsonString, JsonString> topic_names;
+	std::map<JsonString, std::vector<int64_t>> topic_sub_topics;
+	std::map<JsonString, JsonString> venue_names;
+};
+JPARSER_FIELDS(citm_catalog, JPARSER_FIELD_AS(area_names, "areaNames"), JPARSER_FIELD_AS(audience_sub_category_names, "audienceSubCategoryNames"),
+	JPARSER_FIELD(events), JPARSER_FIELD(performances), JPARSER_FIELD_AS(seat_category_names, "seatCategoryNames"),
+	JPARSER_FIELD_AS(sub_topic_names, "subTopicNames"), JPARSER_FIELD_AS(topic_names, "topicNames"),
+	JPARSER_FIELD_AS(topic_sub_topics, "topicSubTopics"), JPARSER_FIELD_AS(venue_names, "venueNames"))
+
+bool parse_args(int argc, char** argv, bench_options& options) {
+	for (int i = 1; i < argc; i++) {
+		const std::string_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--data" && hasValue) {
+			options.data = argv[++i];
+		}
+		else if (arg == "--filter" && hasValue) {
+			options.filter = argv[++i];
+		}
+		else if (arg == "--min-iters" && hasValue) {
+			options.min_iters = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--generate" && hasValue) {
+			const std::string_view spec = argv[++i];
+			const auto colon = spec.find(':');
+			gen_options gen;
+			if (colon == std::string_view::npos || !parse_shape(spec.substr(0, colon), gen.shape) || !parse_size(spec.substr(colon + 1), gen.bytes)) {
+				std::cerr << "bad --generate " << spec << ", expected SHAPE:SIZE like numbers:16M" << std::endl;
+				return false;
+			}
+			options.generate.push_back(gen);
+		}
+		else if (arg == "--threads" && hasValue) {
+			options.threaded = true;
+			options.max_threads = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--seconds" && hasValue) {
+			options.seconds = std::strtod(argv[++i], nullptr);
+		}
+		else if (arg == "--export" && hasValue) {
+			options.export_file = argv[++i];
+		}
+		else if (arg == "--compare" && hasValue) {
+			options.compare_file = argv[++i];
+		}
+		else if (arg == "--tolerance" && hasValue) {
+			options.tolerance = std::strtod(argv[++i], nullptr) / 100;
+		}
+		else {
+			std::cerr << "usage: jparser_bench [--data DIR] [--filter TEXT] [--min-iters N] [--generate SHAPE:SIZE]...\n"
+				"                     [--export FILE.json|.csv|.html] [--compare BASELINE.json] [--tolerance PERCENT]\n"
+				"                     [--threads MAX [--seconds S]]" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// cacheMisses and allocs hold one entry per run, in the same order
+std::vector<stage_result> collect_results(const std::vector<ankerl::nanobench::Result>& runs, const std::vector<std::optional<double>>& cacheMisses,
+	const std::vector<alloc_stats>& allocs) {
+	using Measure = ankerl::nanobench::Result::Measure;
+	std::vector<stage_result> results;
+	for (size_t k = 0; k < runs.size(); k++) {
+		const auto& r = runs[k];
+		// Measurements are per iteration, i.e. per document; batch() only scales the printed table
+		stage_result result{ r.config().mBenchmarkTitle, r.config().mBenchmarkName, static_cast<size_t>(r.config().mBatch),
+			r.median(Measure::elapsed), r.medianAbsolutePercentError(Measure::elapsed), {}, {}, {}, {}, {}, {} };
+		for (size_t i = 0; i < r.size(); i++) {
+			result.samples.push_back(r.get(i, Measure::elapsed));
+		}
+		const auto counter = [&](Measure m) { return r.has(m) ? std::optional<double>(r.median(m)) : std::nullopt; };
+		result.instructions = counter(Measure::instructions);
+		result.cycles = counter(Measure::cpucycles);
+		result.branch_misses = counter(Measure::branchmisses);
+		result.cache_misses = cacheMisses[k];
+		result.allocs = allocs[k];
+		results.push_back(std::move(result));
+	}
+	return results;
+}
+
+bool export_results(const std::vector<ankerl::nanobench::Result>& runs, const std::string& filename) {
+	const auto extension = std::filesystem::path(filename).extension().string();
+	const char* format = ankerl::nanobench::templates::json();
+	if (extension == ".csv") {
+		format = ankerl::nanobench::templates::csv();
+	}
+	else if (extension == ".html") {
+		format = ankerl::nanobench::templates::htmlBoxplot();
+	}
+	std::ofstream ofs(filename, std::ios::out | std::ios::binary);
+	ankerl::nanobench::render(format, runs, ofs);
+	return ofs.good();
+}
+
+// Reads a nanobench JSON export with our own parser
+bool load_baseline(const std::string& filename, std::vector<stage_result>& baseline) {
+	std::ifstream ifs(filename, std::ios::in | std::ios::binary);
+	if (!ifs.is_open()) {
+		std::cerr << "cannot open baseline " << filename << std::endl;
+		return false;
+	}
+	json_parser jp;
+	ifs >> jp;
+	auto doc = jp.try_parse();
+	if (!doc) {
+		std::cerr << filename << ": " << doc.error() << std::endl;
+		return false;
+	}
+	// Lookups never insert and check the type, so a hand-edited or truncated baseline is reported
+	const auto member = [](const job& value, const char* key) -> const job* {
+		const auto* dict = std::get_if<JsonDict>(&value.value);
+		if (dict == nullptr) {
+			return nullptr;
+		}
+		const auto it = dict->find(key);
+		return it != dict->end() ? &it->second : nullptr;
+	};
+	const auto number = [&](const job& value, const char* key, double& out) {
+		const auto* m = member(value, key);
+		if (m == nullptr || !std::holds_alternative<JsonNumber>(m->value)) {
+			return false;
+		}
+		out = std::get<JsonNumber>(m->value);
+		return true;
+	};
+	const auto text = [&](const job& value, const char* key, std::string& out) {
+		const auto* m = member(value, key);
+		if (m == nullptr || !std::holds_alternative<JsonString>(m->value)) {
+			return false;
+		}
+		out = std::get<JsonString>(m->value);
+		return true;
+	};
+	const auto* resultsMember = member(*doc, "results");
+	const auto* results = resultsMember ? std::get_if<JsonArray>(&resultsMember->value) : nullptr;
+	if (results == nullptr) {
+		std::cerr << filename << ": no results array" << std::endl;
+		return false;
+	}
+	for (size_t i = 0; i < results->size(); i++) {
+		const auto& r = (*results)[i];
+		stage_result result{ {}, {}, 0, 0, 0, {}, {}, {}, {}, {}, {} };
+		double batch = 0;
+		if (!text(r, "title", result.file) || !text(r, "name", result.stage) || !number(r, "batch", batch) ||
+			!number(r, "median(elapsed)", result.seconds_per_doc) || !number(r, "medianAbsolutePercentError(elapsed)", result.error)) {
+			std::cerr << filename << ": result " << i << " lacks title, name, batch, median(elapsed) or medianAbsolutePercentError(elapsed)" << std::endl;
+			return false;
+		}
+		result.bytes = static_cast<size_t>(batch);
+		if (const auto* m = member(r, "measurements")) {
+			if (const auto* measurements = std::get_if<JsonArray>(&m->value)) {
+				for (const auto& each : *measurements) {
+					double elapsed;
+					if (number(each, "elapsed", elapsed)) {
+						result.samples.push_back(elapsed);
+					}
+				}
+			}
+		}
+		baseline.push_back(std::move(result));
+	}
+	g_arena.Reset();
+	return true;
+}
+
+// Two-sided Mann-Whitney U test with the normal approximation, returns the p-value that
+// both sets of epoch timings come from the same distribution
+double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b) {
+	if (a.size() < 3 || b.size() < 3) {
+		return 0;	// too few epochs to test, leave the decision to the error estimates
+	}
+	std::vector<std::pair<double, int>> all;
+	for (auto x : a) all.emplace_back(x, 0);
+	for (auto x : b) all.emplace_back(x, 1);
+	std::sort(all.begin(), all.end());
+	double rankSumA = 0;
+	for (size_t i = 0; i < all.size();) {
+		auto j = i;
+		while (j < all.size() && all[j].first == all[i].first) j++;
+		const double rank = (i + j + 1) / 2.0;	// average rank of a tie group, ranks start at 1
+		for (auto k = i; k < j; k++) {
+			if (all[k].second == 0) rankSumA += rank;
+		}
+		i = j;
+	}
+	const double na = static_cast<double>(a.size()), nb = static_cast<double>(b.size());
+	const double u = rankSumA - na * (na + 1) / 2;
+	const double mean = na * nb / 2;
+	const double sigma = std::sqrt(na * nb * (na + nb + 1) / 12);
+	const double z = (std::abs(u - mean) - 0.5) / sigma;
+	return std::erfc((std::max)(z, 0.0) / std::sqrt(2.0));
+}
+
+// A stage is a regression when it is slower by more than the tolerance, by more than the combined
+// error estimates of both runs, and the epoch timings differ significantly. Returns the count.
+int compare_results(const std::vector<stage_result>& baseline, const std::vector<stage_result>& current, double tolerance) {
+	constexpr double Alpha = 0.01;
+	int regressions = 0;
+	std::cout << "\n| " << std::setw(24) << std::left << "file" << " | " << std::setw(12) << "stage" << " | "
+		<< std::setw(9) << std::right << "change" << " | " << std::setw(8) << "noise" << " | " << std::setw(8) << "p" << " | verdict |\n";
+	std::cout << "|:" << std::string(24, '-') << "-|:" << std::string(12, '-') << "-|-" << std::string(9, '-') << ":|-"
+		<< std::string(8, '-') << ":|-" << std::string(8, '-') << ":|:--------|\n";
+	for (const auto& now : current) {
+		const auto before = std::find_if(baseline.begin(), baseline.end(), [&](const stage_result& b) { return b.file == now.file && b.stage == now.stage; });
+		if (before == baseline.end()) {
+			continue;
+		}
+		const double change = now.seconds_per_doc / before->seconds_per_doc - 1;
+		const double noise = now.error + before->error;
+		const double p = mann_whitney_p(before->samples, now.samples);
+		const bool significant = std::abs(change) > (std::max)(tolerance, noise) && p < Alpha;
+		const char* verdict = !significant ? "same" : change > 0 ? "SLOWER" : "faster";
+		regressions += significant && change > 0;
+		std::cout << "| " << std::setw(24) << std::left << now.file << " | " << std::setw(12) << now.stage << " | " << std::right << std::fixed
+			<< std::setw(8) << std::setprecision(1) << change * 100 << "% | " << std::setw(7) << noise * 100 << "% | "
+			<< std::setw(8) << std::setprecision(4) << p << " | " << std::setw(7) << std::left << verdict << " |\n" << std::right;
+	}
+	return regressions;
+}
+
+// Prints a counter column, or "-" if it was not measured
+void print_counter(std::optional<double> value, int width, int precision) {
+	if (value) {
+		std::cout << std::setw(width) << std::setprecision(precision) << *value;
+	}
+	else {
+		std::cout << std::setw(width) << "-";
+	}
+}
+
+void print_summary(const std::vector<stage_result>& results) {
+	std::cout << "\n| " << std::setw(24) << std::left << "file" << " | " << std::setw(12) << "stage" << " | "
+		<< std::setw(10) << std::right << "MB/s" << " | " << std::setw(12) << "docs/s" << " | " << std::setw(7) << "ins/B" << " | "
+		<< std::setw(5) << "IPC" << " | " << std::setw(10) << "brmiss/KB" << " | " << std::setw(10) << "llcmiss/KB" << " | "
+		<< std::setw(8) << "new" << " | " << std::setw(9) << "new KB" << " | " << std::setw(8) << "arena" << " | " << std::setw(9) << "arena KB" << " |\n";
+	std::cout << "|:" << std::string(24, '-') << "-|:" << std::string(12, '-') << "-|-" << std::string(10, '-') << ":|-" << std::string(12, '-')
+		<< ":|-" << std::string(7, '-') << ":|-" << std::string(5, '-') << ":|-" << std::string(10, '-') << ":|-" << std::string(10, '-')
+		<< ":|-" << std::string(8, '-') << ":|-" << std::string(9, '-') << ":|-" << std::string(8, '-') << ":|-" << std::string(9, '-') << ":|\n";
+	for (const auto& r : results) {
+		const double kilobytes = r.bytes / 1024.0;
+		const auto per = [](std::optional<double> value, double divisor) { return value ? std::optional<double>(*value / divisor) : std::nullopt; };
+		const auto ipc = r.instructions && r.cycles && *r.cycles > 0 ? std::optional<double>(*r.instructions / *r.cycles) : std::nullopt;
+		std::cout << "| " << std::setw(24) << std::left << r.file << " | " << std::setw(12) << r.stage << " | " << std::right << std::fixed
+			<< std::setw(10) << std::setprecision(1) << r.bytes / r.seconds_per_doc * 1e-6 << " | "
+			<< std::setw(12) << std::setprecision(1) << 1.0 / r.seconds_per_doc << " | ";
+		print_counter(per(r.instructions, static_cast<double>(r.bytes)), 7, 2);
+		std::cout << " | ";
+		print_counter(ipc, 5, 2);
+		std::cout << " | ";
+		print_counter(per(r.branch_misses, kilobytes), 10, 2);
+		std::cout << " | ";
+		print_counter(per(r.cache_misses, kilobytes), 10, 2);
+		std::cout << " | " << std::setw(8) << r.allocs.heap_allocs << " | " << std::setw(9) << std::setprecision(1) << r.allocs.heap_bytes / 1024.0
+			<< " | " << std::setw(8) << r.allocs.arena_allocs << " | " << std::setw(9) << r.allocs.arena_bytes / 1024.0 << " |\n";
+	}
+}
+
+// What one thread count achieved over its whole run
+struct thread_result {
+	size_t threads;
+	double seconds;
+	uint64_t bytes = 0;
+	uint64_t docs = 0;
+	std::vector<double> latencies;	// seconds of every parse on every thread
+};
+
+// Parses the corpus round-robin on the given number of threads for about the given time. Each thread
+// starts at a different file so they do not move through the corpus in lockstep.
+thread_result run_threads(const std::vector<corpus_file>& corpus, size_t threads, double seconds) {
+	using Clock = std::chrono::steady_clock;
+	std::atomic<size_t> ready{ 0 };
+	std::atomic<bool> go{ false }, stop{ false };
+	std::vector<thread_result> partial(threads);
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < threads; t++) {
+		workers.emplace_back([&, t] {
+			std::vector<json_parser> parsers;
+			for (const auto& file : corpus) {
+				parsers.emplace_back(file.text);
+			}
+			auto& mine = partial[t];
+			mine.latencies.reserve(1 << 16);
+			ready++;
+			while (!go.load(std::memory_order_acquire)) {
+				std::this_thread::yield();
+			}
+			for (size_t i = t % corpus.size(); !stop.load(std::memory_order_relaxed); i = (i + 1) % corpus.size()) {
+				const auto start = Clock::now();
+				{
+					auto parsed = parsers[i].try_parse();
+					ankerl::nanobench::doNotOptimizeAway(parsed);
+				}
+				g_arena.Reset();
+				mine.latencies.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+				mine.bytes += corpus[i].text.size();
+				mine.docs++;
+			}
+			g_arena.Release();
+			});
+	}
+	while (ready.load() < threads) {
+		std::this_thread::yield();
+	}
+	const auto start = Clock::now();
+	go.store(true, std::memory_order_release);
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+	stop = true;
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	thread_result result{ threads, std::chrono::duration<double>(Clock::now() - start).count(), 0, 0, {} };
+	for (auto& p : partial) {
+		result.bytes += p.bytes;
+		result.docs += p.docs;
+		result.latencies.insert(result.latencies.end(), p.latencies.begin(), p.latencies.end());
+	}
+	std::sort(result.latencies.begin(), result.latencies.end());
+	return result;
+}
+
+// Efficiency is throughput relative to N times the single-thread throughput; a drop well below 100%
+// with idle cores left points at contention, in the allocator or elsewhere
+void print_scaling(const std::vector<thread_result>& results) {
+	const auto percentile = [](const std::vector<double>& sorted, double q) {
+		return sorted.empty() ? 0.0 : sorted[static_cast<size_t>(q * (sorted.size() - 1))] * 1e6;
+	};
+	std::cout << "\n| " << std::setw(7) << "threads" << " | " << std::setw(10) << "MB/s" << " | " << std::setw(10) << "docs/s" << " | "
+		<< std::setw(7) << "speedup" << " | " << std::setw(10) << "efficiency" << " | " << std::setw(10) << "p50 us" << " | "
+		<< std::setw(10) << "p90 us" << " | " << std::setw(10) << "p99 us" << " | " << std::setw(10) << "max us" << " |\n";
+	std::cout << "|-" << std::string(7, '-') << ":|-" << std::string(10, '-') << ":|-" << std::string(10, '-') << ":|-" << std::string(7, '-')
+		<< ":|-" << std::string(10, '-') << ":|-" << std::string(10, '-') << ":|-" << std::string(10, '-') << ":|-" << std::string(10, '-')
+		<< ":|-" << std::string(10, '-') << ":|\n";
+	const double single = results.front().bytes / results.front().seconds;
+	for (const auto& r : results) {
+		const double throughput = r.bytes / r.seconds;
+		std::cout << "| " << std::setw(7) << r.threads << " | " << std::fixed << std::setprecision(1) << std::setw(10) << throughput * 1e-6 << " | "
+			<< std::setw(10) << r.docs / r.seconds << " | " << std::setprecision(2) << std::setw(7) << throughput / single << " | "
+			<< std::setprecision(1) << std::setw(9) << throughput / single / r.threads * 100 << "% | "
+			<< std::setw(10) << percentile(r.latencies, 0.5) << " | " << std::setw(10) << percentile(r.latencies, 0.9) << " | "
+			<< std::setw(10) << percentile(r.latencies, 0.99) << " | " << std::setw(10) << percentile(r.latencies, 1) << " |\n";
+	}
+}
+
+// Runs 1, 2, 4... threads up to the maximum, which is always included
+int bench_threads(const bench_options& options) {
+#if !defined(JPARSER_ARENA_THREAD_LOCAL)
+	std::cerr << "--threads needs a build with JPARSER_ARENA_THREAD_LOCAL defined" << std::endl;
+	return 2;
+#endif
+	std::vector<corpus_file> corpus;
+	for (auto& file : load_corpus(options)) {
+		json_parser jp(file.text);
+		if (auto checked = jp.try_parse(); !checked) {
+			std::cout << file.name << " error: " << checked.error() << std::endl;
+			continue;
+		}
+		corpus.push_back(std::move(file));
+	}
+	g_arena.Reset();
+	if (corpus.empty()) {
+		std::cerr << "no documents to parse" << std::endl;
+		return 2;
+	}
+	const size_t maxThreads = options.max_threads ? options.max_threads : (std::max)(std::thread::hardware_concurrency(), 1u);
+	std::vector<thread_result> results;
+	for (size_t threads = 1;; threads = (std::min)(threads * 2, maxThreads)) {
+		results.push_back(run_threads(corpus, threads, options.seconds));
+		if (threads == maxThreads) {
+			break;
+		}
+	}
+	print_scaling(results);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	bench_options options;
+	if (!parse_args(argc, argv, options)) {
+		return 2;
+	}
+
+	if (options.threaded) {
+		return bench_threads(options);
+	}
+
+	std::vector<stage_result> baseline;
+	if (!options.compare_file.empty() && !load_baseline(options.compare_file, baseline)) {
+		return 2;
+	}
+
+	// A Bench drops its results when the title changes, so every file's runs are kept here
+	std::vector<ankerl::nanobench::Result> runs;
+	std::vector<std::optional<double>> cacheMisses;
+	std::vector<alloc_stats> allocs;
+	cache_miss_counter cacheCounter;
+	for (const auto& file : load_corpus(options)) {
+		json_parser jp(file.text);
+		if (auto checked = jp.try_parse(); !checked) {
+			std::cout << file.name << " error: " << checked.error() << std::endl;
+			continue;
+		}
+		g_arena.Reset();
+		json_parser strict(file.text, parse_options{ true });
+		parse_options packOptions;
+		packOptions.pack_numbers = true;
+		json_parser packed(file.text, packOptions);
+		parse_options lazyOptions;
+		lazyOptions.lazy_numbers = true;
+		lazyOptions.lazy_strings = true;
+		json_parser lazy(file.text, lazyOptions);
+		json_writer writer;
+
+		ankerl::nanobench::Bench bench;
+		bench.title(file.name).unit("byte").batch(file.text.size()).minEpochIterations(options.min_iters).warmup(1).performanceCounters(true);
+		// Times the stage, then repeats it once to count allocations and a few times with the cache miss counter enabled
+		const auto stage = [&](const char* name, auto&& fn) {
+			bench.run(name, fn);
+			allocs.push_back(count_allocations(fn));
+			cacheMisses.push_back(cacheCounter.Measure(fn, options.min_iters));
+		};
+
+		// Stages that reset the arena run before or after the lifetime of doc, never during it
+		stage("parse", [&] {
+			{
+				auto parsed = jp.try_parse();
+				ankerl::nanobench::doNotOptimizeAway(parsed);
+			}
+			g_arena.Reset();
+			});
+		stage("parse utf-8", [&] {
+			{
+				auto parsed = strict.try_parse();
+				ankerl::nanobench::doNotOptimizeAway(parsed);
+			}
+			g_arena.Reset();
+			});
+		stage("parse packed", [&] {
+			{
+				auto parsed = packed.try_parse();
+				ankerl::nanobench::doNotOptimizeAway(parsed);
+			}
+			g_arena.Reset();
+			});
+		stage("parse lazy", [&] {
+			{
+				auto parsed = lazy.try_parse();
+				ankerl::nanobench::doNotOptimizeAway(parsed);
+			}
+			g_arena.Reset();
+			});
+		{
+			const auto doc = *jp.try_parse();
+			stage("traverse", [&] {
+				traverse_stats stats;
+				traverse(doc, stats);
+				ankerl::nanobench::doNotOptimizeAway(stats);
+				});
+			stage("serialize", [&] {
+				ankerl::nanobench::doNotOptimizeAway(writer.write(doc));
+				});
+		}
+		g_arena.Reset();
+		stage("round-trip", [&] {
+			{
+				auto parsed = *jp.try_parse();
+				json_parser reparser{ std::string(writer.write(parsed)) };
+				auto reparsed = *reparser.try_parse();
+				ankerl::nanobench::doNotOptimizeAway(writer.write(reparsed));
+			}
+			g_arena.Reset();
+			});
+		// Straight into the typed models, for the files that have one
+		const auto typed = [&](auto model) {
+			json_struct_parser decoder(file.text);
+			stage("typed decode", [&] {
+				{
+					auto decoded = decoder.try_parse<decltype(model)>();
+					ankerl::nanobench::doNotOptimizeAway(decoded);
+				}
+				g_arena.Reset();
+				});
+			{
+				const auto decoded = *decoder.try_parse<decltype(model)>();
+				stage("typed encode", [&] {
+					ankerl::nanobench::doNotOptimizeAway(write_typed(writer, decoded));
+					});
+			}
+			g_arena.Reset();
+		};
+		if (file.name == "twitter.json") {
+			typed(twitter_search{});
+		}
+		else if (file.name == "citm_catalog.json") {
+			typed(citm_catalog{});
+		}
+		// The typed decoder against building the DOM and extracting the same pattern from it
+		if (std::filesystem::path(file.name).extension() == ".ahap") {
+			ahap_parser decoder(file.text);
+			HapticPattern pattern;
+			stage("ahap decode", [&] {
+				decoder.decode(pattern);
+				ankerl::nanobench::doNotOptimizeAway(pattern.event_time.data());
+				g_arena.Reset();
+				});
+			stage("ahap via dom", [&] {
+				{
+					const auto doc = *jp.try_parse();
+					ahap_from_dom(doc, pattern);
+					ankerl::nanobench::doNotOptimizeAway(pattern.event_time.data());
+				}
+				g_arena.Reset();
+				});
+			// Playback: index the pattern, then sweep it in 240 Hz windows as one batch
+			decoder.decode(pattern);
+			std::vector<haptic_window> windows;
+			std::vector<float> starts;
+			const auto view = pattern.view();
+			const float length = view.event_count() ? *std::max_element(view.event_time.begin(), view.event_time.end()) + 1 : 0;
+			for (float t = 0; t < length; t += 1.0f / 240) {
+				windows.push_back({ t, t + 1.0f / 240 });
+				starts.push_back(t);
+			}
+			HapticTimeline timeline;
+			std::vector<uint32_t> active, offsets;
+			std::vector<float> intensity(starts.size());
+			stage("ahap sweep", [&] {
+				timeline.build(view);
+				timeline.events_in({ windows.data(), windows.size() }, active, offsets);
+				timeline.values(haptic_dynamic_parameter::haptic_intensity_control, { starts.data(), starts.size() }, intensity.data(), 1);
+				ankerl::nanobench::doNotOptimizeAway(active.data());
+				});
+			// Every curve rendered at an audio rate
+			std::vector<float> samples;
+			stage("ahap render", [&] {
+				render_curves(view, 48000, samples, offsets);
+				ankerl::nanobench::doNotOptimizeAway(samples.data());
+				});
+			// Start-up cost of a compiled pattern: map, validate and unmap the binary file
+			const auto compiled = std::filesystem::temp_directory_path() / (file.name + ".ahapb");
+			if (save_ahap_binary(pattern.view(), compiled.string().c_str())) {
+				ahap_binary_file binary;
+				stage("ahap load", [&] {
+					binary.open(compiled.string().c_str());
+					ankerl::nanobench::doNotOptimizeAway(binary.view().event_time.data());
+					binary.close();
+					});
+				std::filesystem::remove(compiled);
+			}
+		}
+		runs.insert(runs.end(), bench.results().begin(), bench.results().end());
+	}
+	const auto results = collect_results(runs, cacheMisses, allocs);
+	print_summary(results);
+	if (!options.export_file.empty() && !export_results(runs, options.export_file)) {
+		std::cerr << "cannot write " << options.export_file << std::endl;
+		return 2;
+	}
+	int regressions = 0;
+	if (!baseline.empty()) {
+		regressions = compare_results(baseline, results, options.tolerance);
+		std::cout << "\n" << regressions << " significant slowdown(s) against " << options.compare_file << std::endl;
+	}
+	g_arena.Release();
+	return regressions == 0 ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+// generator.cpp : Writes a synthetic JSON document, see generator.h.
+//
+// usage: jparser_gen [--shape deep|wide|strings|numbers|ahap|mixed] [--size BYTES[K|M|G]] [--seed N]
+//                    [--depth N] [--width N] [--string-length N] [--indent N] [-o FILE]
+//
+// Output is streamed, so multi-gigabyte documents need no more memory than small ones.
+
+#include "generator.h"
+#include <cstdio>
+
+#if defined(_WIN32)
+#define fileno _fileno
+#endif
+
+int main(int argc, char** argv)
+{
+	gen_options options;
+	write_options format;
+	const char* output = nullptr;
+	for (int i = 1; i < argc; i++) {
+		const std::string_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		bool ok = hasValue;
+		if (arg == "--shape" && hasValue) {
+			ok = parse_shape(argv[++i], options.shape);
+		}
+		else if (arg == "--size" && hasValue) {
+			ok = parse_size(argv[++i], options.bytes);
+		}
+		else if (arg == "--seed" && hasValue) {
+			options.seed = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--depth" && hasValue) {
+			options.depth = std::atoi(argv[++i]);
+		}
+		else if (arg == "--width" && hasValue) {
+			options.width = std::atoi(argv[++i]);
+		}
+		else if (arg == "--string-length" && hasValue) {
+			ok = parse_size(argv[++i], options.string_length);
+		}
+		else if (arg == "--indent" && hasValue) {
+			format.indent = std::atoi(argv[++i]);
+		}
+		else if (arg == "-o" && hasValue) {
+			output = argv[++i];
+		}
+		else {
+			ok = false;
+		}
+		if (!ok) {
+			std::cerr << "usage: jparser_gen [--shape deep|wide|strings|numbers|ahap|mixed] [--size BYTES[K|M|G]] [--seed N]\n"
+				"                   [--depth N] [--width N] [--string-length N] [--indent N] [-o FILE]" << std::endl;
+			return 2;
+		}
+	}
+
+	std::FILE* file = output ? std::fopen(output, "wb") : stdout;
+	if (file == nullptr) {
+		std::cerr << "cannot open " << output << std::endl;
+		return 1;
+	}
+	std::fflush(file);
+	bool ok;
+	{
+		json_writer writer(fd_sink(fileno(file)), format, 1024 * 1024);
+		ok = generate_json(writer, options);
+	}
+	if (output) {
+		ok = std::fclose(file) == 0 && ok;
+	}
+	if (!ok) {
+		std::cerr << "write failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,308 @@
+#pragma once
+
+// Deterministic synthetic JSON for scaling benchmarks. A document is a top-level array of records of
+// one shape (the Pattern array of an AHAP file for gen_shape::ahap), appended until the target size
+// is reached, so the same options and seed always give the same bytes. Output goes through
+// json_writer's event API: a streaming writer produces documents of any size in bounded memory,
+// a contiguous writer keeps the text in view().
+
+#include "jparser.h"
+
+enum class gen_shape
+{
+	deep,		// chains of nested dicts and arrays
+	wide,		// objects with many keys
+	strings,	// long strings full of escapes and multi-byte UTF-8
+	numbers,	// coordinate arrays, like canada.json
+	ahap,		// haptic event lists, like the .ahap files in data/
+	mixed,		// all of the above, in random order
+};
+
+struct gen_options {
+	gen_shape shape = gen_shape::mixed;
+	size_t bytes = 1024 * 1024;	// the output stops at the first record boundary past this size
+	uint64_t seed = 1;
+	int depth = 64;				// nesting of a deep record, keep below parse_options::max_depth
+	int width = 64;				// keys of a wide record
+	size_t string_length = 256;	// bytes of a long string
+};
+
+inline const char* shape_name(gen_shape shape) {
+	switch (shape) {
+	case gen_shape::deep: return "deep";
+	case gen_shape::wide: return "wide";
+	case gen_shape::strings: return "strings";
+	case gen_shape::numbers: return "numbers";
+	case gen_shape::ahap: return "ahap";
+	case gen_shape::mixed: return "mixed";
+	}
+	return "";
+}
+
+inline bool parse_shape(std::string_view name, gen_shape& shape) {
+	for (auto s : { gen_shape::deep, gen_shape::wide, gen_shape::strings, gen_shape::numbers, gen_shape::ahap, gen_shape::mixed }) {
+		if (name == shape_name(s)) {
+			shape = s;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Reads sizes like "4096", "64K", "10M" or "2G" (binary units)
+inline bool parse_size(std::string_view text, size_t& bytes) {
+	size_t value = 0;
+	size_t i = 0;
+	for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++) {
+		value = value * 10 + (text[i] - '0');
+	}
+	if (i == 0) {
+		return false;
+	}
+	if (i < text.size()) {
+		switch (text[i++]) {
+		case 'k': case 'K': value <<= 10; break;
+		case 'm': case 'M': value <<= 20; break;
+		case 'g': case 'G': value <<= 30; break;
+		default: return false;
+		}
+	}
+	bytes = value;
+	return i == text.size();
+}
+
+// splitmix64, so the output does not depend on the standard library's distributions
+class GenRandom
+{
+	uint64_t m_state;
+
+public:
+	explicit GenRandom(uint64_t seed) : m_state(seed) {}
+
+	uint64_t Next()
+	{
+		uint64_t z = (m_state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	// Uniform in [0, n)
+	uint64_t Below(uint64_t n)
+	{
+		return Next() % n;
+	}
+
+	// Uniform in [0, 1)
+	double Unit()
+	{
+		return (Next() >> 11) * 0x1.0p-53;
+	}
+};
+
+class json_generator
+{
+	json_writer& m_writer;
+	const gen_options& m_options;
+	GenRandom m_random;
+	std::string m_text;		// scratch for generated strings and keys
+	double m_time = 0;		// running clock of ahap records
+
+public:
+	json_generator(json_writer& writer, const gen_options& options) :
+		m_writer(writer), m_options(options), m_random(options.seed) {}
+
+	// Writes one document. False if the writer's sink refused output.
+	bool generate() {
+		m_writer.clear();
+		// Pure ahap output is a complete pattern file, the records are its Pattern entries
+		const bool pattern = m_options.shape == gen_shape::ahap;
+		if (pattern) {
+			m_writer.begin_dict();
+			m_writer.key("Version");
+			m_writer.value(1.0);
+			m_writer.key("Pattern");
+		}
+		m_writer.begin_array();
+		while (m_writer.written() < m_options.bytes && m_writer.good()) {
+			auto shape = m_options.shape;
+			if (shape == gen_shape::mixed) {
+				shape = static_cast<gen_shape>(m_random.Below(static_cast<uint64_t>(gen_shape::mixed)));
+			}
+			record(shape);
+		}
+		m_writer.end_array();
+		if (pattern) {
+			m_writer.end_dict();
+		}
+		return m_writer.flush();
+	}
+
+private:
+	void record(gen_shape shape) {
+		switch (shape) {
+		case gen_shape::deep: deep(); break;
+		case gen_shape::wide: wide(); break;
+		case gen_shape::strings: strings(); break;
+		case gen_shape::numbers: numbers(); break;
+		case gen_shape::ahap: ahap(); break;
+		case gen_shape::mixed: break;
+		}
+	}
+
+	// {"level":[{"level":[... {"leaf":n} ...]}]}, alternating dicts and arrays
+	void deep() {
+		const int depth = (std::max)(m_options.depth / 2, 1);
+		for (int i = 0; i < depth; i++) {
+			m_writer.begin_dict();
+			m_writer.key("level");
+			m_writer.begin_array();
+		}
+		m_writer.begin_dict();
+		m_writer.key("leaf");
+		m_writer.value(static_cast<JsonNumber>(m_random.Below(1000000)));
+		m_writer.end_dict();
+		for (int i = 0; i < depth; i++) {
+			m_writer.end_array();
+			m_writer.end_dict();
+		}
+	}
+
+	void wide() {
+		char name[24];	// "field_" and any int
+		m_writer.begin_dict();
+		for (int i = 0; i < m_options.width; i++) {
+			std::snprintf(name, sizeof(name), "field_%05d", i);
+			m_writer.key(name);
+			switch (m_random.Below(4)) {
+			case 0: m_writer.value(static_cast<JsonNumber>(m_random.Below(1 << 20))); break;
+			case 1: m_writer.value(m_random.Unit() * 1000); break;
+			case 2: m_writer.value(JsonBoolean(m_random.Below(2) == 1)); break;
+			default: m_writer.value(JsonString(word())); break;
+			}
+		}
+		m_writer.end_dict();
+	}
+
+	void strings() {
+		m_writer.begin_dict();
+		m_writer.key("id");
+		m_writer.value(static_cast<JsonNumber>(m_random.Below(1ull << 40)));
+		m_writer.key("text");
+		m_writer.value(JsonString(long_string()));
+		m_writer.end_dict();
+	}
+
+	// A GeoJSON polygon with one ring of full-precision coordinates
+	void numbers() {
+		const auto points = 16 + m_random.Below(240);
+		m_writer.begin_dict();
+		m_writer.key("type");
+		m_writer.value("Feature");
+		m_writer.key("geometry");
+		m_writer.begin_dict();
+		m_writer.key("type");
+		m_writer.value("Polygon");
+		m_writer.key("coordinates");
+		m_writer.begin_array();
+		m_writer.begin_array();
+		double lon = m_random.Unit() * 360 - 180, lat = m_random.Unit() * 180 - 90;
+		for (uint64_t i = 0; i < points; i++) {
+			lon += m_random.Unit() * 0.02 - 0.01;
+			lat += m_random.Unit() * 0.02 - 0.01;
+			m_writer.begin_array();
+			m_writer.value(lon);
+			m_writer.value(lat);
+			m_writer.end_array();
+		}
+		m_writer.end_array();
+		m_writer.end_array();
+		m_writer.end_dict();
+		m_writer.end_dict();
+	}
+
+	// One Pattern entry: an Event or a ParameterCurve, with times increasing across records
+	void ahap() {
+		m_time += 0.01 + 0.1 * m_random.Unit();
+		m_writer.begin_dict();
+		if (m_random.Below(4) == 0) {
+			m_writer.key("ParameterCurve");
+			m_writer.begin_dict();
+			m_writer.key("ParameterID");
+			m_writer.value(m_random.Below(2) ? "HapticIntensityControl" : "HapticSharpnessControl");
+			m_writer.key("Time");
+			m_writer.value(m_time);
+			m_writer.key("ParameterCurveControlPoints");
+			m_writer.begin_array();
+			const auto points = 2 + m_random.Below(15);
+			double t = 0;
+			for (uint64_t i = 0; i < points; i++) {
+				m_writer.begin_dict();
+				m_writer.key("Time");
+				m_writer.value(t);
+				m_writer.key("ParameterValue");
+				m_writer.value(m_random.Unit());
+				m_writer.end_dict();
+				t += 0.05 + 0.2 * m_random.Unit();
+			}
+			m_writer.end_array();
+			m_writer.end_dict();
+		}
+		else {
+			const bool continuous = m_random.Below(3) == 0;
+			m_writer.key("Event");
+			m_writer.begin_dict();
+			m_writer.key("Time");
+			m_writer.value(m_time);
+			m_writer.key("EventType");
+			m_writer.value(continuous ? "HapticContinuous" : "HapticTransient");
+			if (continuous) {
+				m_writer.key("EventDuration");
+				m_writer.value(0.1 + m_random.Unit());
+			}
+			m_writer.key("EventParameters");
+			m_writer.begin_array();
+			for (auto id : { "HapticIntensity", "HapticSharpness" }) {
+				m_writer.begin_dict();
+				m_writer.key("ParameterID");
+				m_writer.value(id);
+				m_writer.key("ParameterValue");
+				m_writer.value(m_random.Unit());
+				m_writer.end_dict();
+			}
+			m_writer.end_array();
+			m_writer.end_dict();
+		}
+		m_writer.end_dict();
+	}
+
+	const std::string& word() {
+		m_text.clear();
+		const auto n = 3 + m_random.Below(10);
+		for (uint64_t i = 0; i < n; i++) {
+			m_text += static_cast<char>('a' + m_random.Below(26));
+		}
+		return m_text;
+	}
+
+	// Mostly ASCII words, with quotes, backslashes, control characters and 2-, 3- and 4-byte
+	// UTF-8 sequences sprinkled in so both the escaper and the unescaper have work to do
+	const std::string& long_string() {
+		static constexpr const char* Specials[] = { "\"", "\\", "\n", "\t", "\x01", "/", "\xc3\xa9", "\xe4\xb8\xad", "\xf0\x9f\x98\x80" };
+		m_text.clear();
+		while (m_text.size() < m_options.string_length) {
+			const auto n = 1 + m_random.Below(8);
+			for (uint64_t i = 0; i < n; i++) {
+				m_text += static_cast<char>('a' + m_random.Below(26));
+			}
+			m_text += m_random.Below(8) == 0 ? Specials[m_random.Below(std::size(Specials))] : " ";
+		}
+		return m_text;
+	}
+};
+
+// Writes one document with the given options, see json_generator
+inline bool generate_json(json_writer& writer, const gen_options& options) {
+	json_generator generator(writer, options);
+	return generator.generate();
+}
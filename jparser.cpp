@@ -1,647 +1,416 @@
 // jparser.cpp : This file contains the 'main' function. Program execution begins and ends there.
 //
+// Round-trips every file of the data directory: parse, write, parse the output again, plain, with
+// packed numeric arrays and with lazy numbers and strings, and check that all documents serialize
+// identically. Timings live in bench.cpp.
+//
+// Then runs edge cases that no data file reaches.
 
-#include <iostream>
-#include <vector>
-#include <unordered_map>
-#include <fstream>
-#include <sstream>
-#include <string>
-#include <map>
-#include <list>
-#include <variant>
-#define ANKERL_NANOBENCH_IMPLEMENT
-#include "nanobench.h"
-
-constexpr std::size_t CashLine = 64;
+#include "jparser.h"
+#include "json_bind.h"
+#include "ahap_render.h"
+#include "generator.h"
+#include <filesystem>
 
-void* AllocAligned(std::size_t size, int align) {
-	return _aligned_malloc(size, align);
-}
+#ifndef JPARSER_DATA_DIR
+#define JPARSER_DATA_DIR "data"
+#endif
 
-void FreeAligned(void* ptr) {
-	_aligned_free(ptr);
-}
+struct integer_bounds {
+	std::optional<int64_t> a;
+	std::optional<uint64_t> b;
+};
+JPARSER_FIELDS(integer_bounds, JPARSER_FIELD(a), JPARSER_FIELD(b))
 
-template <typename T>
-T* AllocAligned(std::size_t n)
-{
-	return (T*)(AllocAligned(sizeof(T) * n, 64));
+struct tree_node {
+	std::vector<tree_node> children;
+};
+JPARSER_FIELDS(tree_node, JPARSER_FIELD(children))
+
+// A recursive bound type recurses once per level in the typed decoder, so it obeys the same depth
+// limit as the DOM parser: every node is a struct and an array, two levels
+bool check_typed_depth() {
+	const auto nodes = [](size_t count) {
+		std::string text;
+		for (size_t i = 0; i < count; i++) {
+			text += "{\"children\":[";
+		}
+		for (size_t i = 0; i < count; i++) {
+			text += "]}";
+		}
+		return text;
+	};
+	const size_t limit = parse_options::MaxDepth / 2;
+	json_struct_parser fits(nodes(limit));
+	json_struct_parser past(nodes(limit + 1));
+	json_struct_parser huge(nodes(100000));
+	const auto fits_tree = fits.try_parse<tree_node>();
+	const auto past_tree = past.try_parse<tree_node>();
+	const auto huge_tree = huge.try_parse<tree_node>();
+	return fits_tree && !past_tree && past_tree.error().kind == error_kind::depth_exceeded && past_tree.error().offset == limit * 13 &&
+		!huge_tree && huge_tree.error().kind == error_kind::depth_exceeded;
 }
 
-// A region-based memory manager "Fast allocation and deallocation of memory based on object lifetimes"
-template <int nCashLine = 64>
-class DataArena
-{
-	const size_t m_blockSize;
-	size_t m_currentBlockPos;
-	size_t m_currentAllocBlockSize;
-	uint8_t* m_currentBlock;
-	size_t m_fragmentSize;
-	//std::vector<int> m_pos;
-	std::list<std::pair<uint8_t*, int>> m_used;
-	std::list<std::pair<uint8_t*, int>> m_available;
-
-public:
-	explicit DataArena(size_t size = 1024 * 1024) :
-		m_blockSize(size),
-		m_currentAllocBlockSize(0),
-		m_currentBlock(nullptr),
-		m_currentBlockPos(0),
-		m_fragmentSize(0)
-	{
-		// Default block is 1MB
-	}
-
-	DataArena(const DataArena& arena) = delete;
-	DataArena& operator=(const DataArena& arena) = delete;
-
-	DataArena(DataArena&& arena) noexcept :
-		m_blockSize(arena.m_blockSize), m_currentBlockPos(arena.m_currentBlockPos), m_currentAllocBlockSize(arena.m_currentAllocBlockSize), m_currentBlock(arena.m_currentBlock), m_fragmentSize(arena.m_fragmentSize), m_used(std::move(arena.m_used)), m_available(std::move(arena.m_available))
-	{
-		arena.m_currentBlock = nullptr;
-	}
-
-	DataArena& operator=(DataArena&& arena) noexcept
-	{
-		Release();	// Release memory
-		m_blockSize = arena.m_blockSize;
-		m_currentBlockPos = arena.m_currentBlockPos;
-		m_currentAllocBlockSize = arena.m_currentAllocBlockSize;
-		m_currentBlock = arena.m_currentBlock;
-		arena.m_currentBlock = nullptr;
-		m_fragmentSize = arena.m_fragmentSize;
-		m_used = std::move(arena.m_used);
-		m_available = std::move(arena.m_available);
-		return *this;
-	}
-
-	void* Alloc(size_t bytes)
-	{
-		const auto align = alignof(std::max_align_t);
-		bytes = (bytes + align - 1) & ~(align - 1);	 // Find a proper size to match the aligned boundary
-		if (m_currentBlockPos + bytes > m_currentAllocBlockSize) {
-			// Put into used list. A fragment generates.
-			if (m_currentBlock) {
-				m_used.push_back(std::make_pair(m_currentBlock, m_currentAllocBlockSize));
-				m_fragmentSize += m_currentAllocBlockSize - m_currentBlockPos;
-				m_currentBlock = nullptr;
-				m_currentBlockPos = 0;
-				//std::cout << "Current block can not accommodate this size, put it into used list.\n";
-			}
-
-			// Try to find available block
-			for (auto it = m_available.begin(); it != m_available.end(); ++it) {
-				if (bytes <= it->second) {
-					m_currentBlock = it->first;
-					m_currentAllocBlockSize = it->second;
-					m_currentBlockPos = 0;
-					break;
-				}
-			}
-
-			if (!m_currentBlock) {
-				// Available space can not be found. Allocates new memory
-				m_currentAllocBlockSize = (std::max)(bytes, m_blockSize);
-				m_currentBlock = static_cast<uint8_t*>(AllocAligned(m_currentAllocBlockSize, nCashLine));
-				if (m_currentBlock == nullptr) {
-					return nullptr;
-				}
-				m_currentBlockPos = 0;
-			}
-			m_currentBlockPos = 0;
+// Integers written as doubles or past 64 bits convert through a double, whose nearest value to
+// the type's maximum is one past it
+bool check_integer_bounds() {
+	const struct {
+		const char* json;
+		bool decodes;
+		integer_bounds expected;
+	} cases[] = {
+		{ R"({"a":9223372036854775808.0})", false, {} },
+		{ R"({"a":9223372036854774784.0})", true, { 9223372036854774784, std::nullopt } },
+		{ R"({"a":-9223372036854775808.0})", true, { std::numeric_limits<int64_t>::min(), std::nullopt } },
+		{ R"({"a":-9223372036854777856.0})", false, {} },
+		{ R"({"b":18446744073709551616})", false, {} },
+		{ R"({"b":18446744073709551616.0})", false, {} },
+		{ R"({"b":18446744073709549568.0})", true, { std::nullopt, 18446744073709549568u } },
+		{ R"({"b":18446744073709551615})", true, { std::nullopt, std::numeric_limits<uint64_t>::max() } },
+	};
+	for (const auto& each : cases) {
+		json_struct_parser jp(each.json);
+		integer_bounds value;
+		const bool decoded = jp.decode(value);
+		if (decoded != each.decodes || (decoded && (value.a != each.expected.a || value.b != each.expected.b))) {
+			return false;
 		}
-		const auto ptr = m_currentBlock + m_currentBlockPos;
-		m_currentBlockPos += bytes;
-		return ptr;
-	}
-
-	/**
-	 * \brief Allocate for \a n objects for type \a T, runs constructor depends on \a construct on it and return its pointer
-	 *
-	 * \note For safety, this function should be check if the \a T is a type of POD or trivial.
-	 *		 Maybe it can be checked by \a std::is_trivial or \a std::is_pod(deprecated).
-	 *		 This issued will be addressed later.
-	 *
-	 * \sa Reset()
-	 */
-	template <typename T>
-	T* Alloc(size_t n, bool construct = true)
-	{
-		const auto ptr = static_cast<T*>(Alloc(n * sizeof(T)));
-		if (ptr == nullptr)
-			return nullptr;
-		if (construct)
-			for (auto i = 0; i < n; i++)
-				new (&ptr[i]) T();
-		return ptr;
-	}
-
-	template <typename T, typename... Args>
-	T* AllocConstruct(Args &&... args)
-	{
-		const auto ptr = static_cast<T*>(Alloc(sizeof(T)));
-		if (ptr == nullptr) return nullptr;
-		new (ptr) T(std::forward<Args>(args)...);
-		return ptr;
-	}
-
-	void Release()
-	{
-		for (auto it = m_used.begin(); it != m_used.end(); ++it) FreeAligned(it->first);
-		for (auto it = m_available.begin(); it != m_available.end(); ++it) FreeAligned(it->first);
-		//FreeAligned(m_currentBlock);
-	}
-
-	void Shrink()
-	{
-		for (auto it = m_available.begin(); it != m_available.end(); ++it) FreeAligned(it->first);
-	}
-
-	void Reset()
-	{
-		m_currentBlockPos = 0;
-		m_fragmentSize = 0;
-		m_available.splice(m_available.begin(), m_used);
-	}
-
-	size_t TotalAllocated() const
-	{
-		auto alloc = m_currentAllocBlockSize;
-		for (auto it = m_used.begin(); it != m_used.end(); ++it) alloc += it->second;
-		for (auto it = m_available.begin(); it != m_available.end(); ++it) alloc += it->second;
-		return alloc;
-	}
-
-	size_t FragmentSize() const
-	{
-		return m_fragmentSize;
-	}
-
-	double FragmentRate() const
-	{
-		return static_cast<double>(m_fragmentSize) / TotalAllocated();
-	}
-
-	~DataArena()
-	{
-		Release();
-	}
-};
-
-using Arena64 = DataArena<64>;
-
-Arena64 g_arena(1024 * 1024 * 1024);
-
-template<class T>
-struct ArenaAllocator
-{
-	typedef T value_type;
-
-	// Arena64* m_arena = nullptr;
-	ArenaAllocator() = default;
-
-	template<class U>
-	constexpr ArenaAllocator(const ArenaAllocator <U>&) noexcept {}
-
-	T* allocate(std::size_t n)
-	{
-		return (T*)g_arena.Alloc(n * sizeof(T));
-		//return (T*)std::malloc(n);
 	}
-
-	void deallocate(T* p, std::size_t n) noexcept
-	{
-		//return std::free(p);
-		//std::cout << "dealloate: " << n << std::endl;;
-	}
-};
-
-template<class T, class U>
-inline bool operator==(const ArenaAllocator <T>&, const ArenaAllocator <U>&) {
 	return true;
 }
 
-template<class T, class U>
-inline bool operator!=(const ArenaAllocator <T>&, const ArenaAllocator <U>&) {
-	return false;
-}
-
-
-enum class object_type {
-	dict,
-	array,
-	text,
-	number,
-	null,
-	boolean
-};
-
-struct job;
-// using JsonString = std::string;// std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;;
-using JsonString = std::string_view;// std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;;
-//using JsonArray = std::vector<job, ArenaAllocator<job>>;
-using JsonArray = std::vector<job>;
-//using JsonArray = std::list<job, ArenaAllocator<job>>;
-using JsonDict = std::map<
-	JsonString,
-	job,
-	std::less<JsonString>,
-	ArenaAllocator<std::pair<const JsonString, job>>>;
-// using JsonDict = std::unordered_map<JsonString, job, std::hash<JsonString>, std::equal_to<JsonString>, ArenaAllocator<std::pair<const JsonString, job>>>;
-// using JsonDict = std::unordered_map<JsonString, job>;
-// using JsonDict = std::map<JsonString, job>;
-using JsonNumber = double;
-using JsonBoolean = bool;
-struct JsonNull {};
-
-
-// perfermance rank:
-/*
-
-list/treemap with a good allocator
-
-vector/treemap with good allocator
-
-list/treemap
-
-vector with allocator / treemap
-
-vector/treemap
-
-vector/hashmap
-
-*/
-
-template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
-template<class... Ts> overloaded(Ts...)->overloaded<Ts...>;
-
-struct job {
-	std::variant<JsonNumber, JsonBoolean, JsonString, JsonDict, JsonArray, JsonNull> value;
-	job() : value(JsonNull()) {}
-	job(JsonNumber n) : value(n) {}
-	job(JsonBoolean v) : value(v) {}
-	job(JsonString text) : value(text) {}
-	job(JsonDict dict) : value(std::move(dict)) {}
-	job(JsonArray array) : value(std::move(array)) {}
-
-	job(job&&)noexcept = default;
-	job& operator=(job&&)noexcept = default;
-
-	//job(job& other){
-	//}
-	//job& operator=(const job& other) {
-	//	return *this;
-	//}
-
-	job& operator[](const JsonString& key) {
-		return std::visit([&](auto&& arg)->job& {
-			using T = std::decay_t<decltype(arg)>;
-			if constexpr (std::is_same_v<T, JsonDict>) {
-				return arg[key];
+// Each sequence is placed at several offsets so it also straddles the vector boundaries of Utf8Checker
+bool check_utf8() {
+	const std::pair<const char*, bool> sequences[] = {
+		{ "\xc3\xa9", true },					// U+00E9
+		{ "\xe2\x82\xac", true },				// U+20AC
+		{ "\xef\xbf\xbf", true },				// U+FFFF
+		{ "\xf0\x9f\x98\x80", true },			// U+1F600
+		{ "\xf4\x8f\xbf\xbf", true },			// U+10FFFF, the last code point
+		{ "\xc0\xaf", false },					// overlong '/'
+		{ "\xc1\xbf", false },					// overlong U+007F
+		{ "\xe0\x80\xaf", false },				// overlong in three bytes
+		{ "\xe0\x9f\xbf", false },				// overlong U+07FF
+		{ "\xf0\x80\x80\xaf", false },			// overlong in four bytes
+		{ "\xf0\x8f\xbf\xbf", false },			// overlong U+FFFF
+		{ "\xed\xa0\x80", false },				// high surrogate U+D800
+		{ "\xed\xbf\xbf", false },				// low surrogate U+DFFF
+		{ "\xc3", false },						// truncated two-byte sequence
+		{ "\xe2\x82", false },					// truncated three-byte sequence
+		{ "\xf0\x9f\x98", false },				// truncated four-byte sequence
+		{ "\xa9", false },						// lone continuation byte
+		{ "\xf4\x90\x80\x80", false },			// U+110000, past the last code point
+		{ "\xf5\x80\x80\x80", false },			// lead byte that can only start code points past U+10FFFF
+		{ "\xff", false },
+	};
+	parse_options validate;
+	validate.validate_utf8 = true;
+	for (const auto& [sequence, valid] : sequences) {
+		for (const size_t offset : { 0, 1, 14, 15, 30, 31, 40 }) {
+			const std::string text = "[\"" + std::string(offset, 'a') + sequence + std::string(offset % 7, 'b') + "\"]";
+			json_parser jp(text, validate);
+			const auto doc = jp.try_parse();
+			if (doc.has_value() != valid || (!doc && doc.error().kind != error_kind::invalid_utf8)) {
+				return false;
 			}
-			}, value);
-	}
-
-	template<typename T>
-	T as() {
-		if (auto* ptr = std::get_if<T>(&value)) {
-			return*ptr;
 		}
-		throw std::runtime_error("value is invalid");
-	}
-
-	void pretty_print(std::ostream& os)const {
-		int indent = 0;
-		_print(indent, os);
-		os << std::endl;
 	}
+	return true;
+}
 
-	void _print_indent(int n, std::ostream& os)const {
-		while (n--) {
-			os << "\t";
+// The interval tree query must return exactly what a scan of every event returns, in start order with
+// ties in pattern order. Start times are often repeated and durations are sometimes zero or negative.
+bool check_timeline() {
+	GenRandom random(42);
+	for (const size_t n : { 0, 1, 2, 3, 7, 15, 16, 17, 31, 100, 1000 }) {
+		HapticPattern pattern;
+		for (size_t i = 0; i < n; i++) {
+			const float start = random.Below(2) ? static_cast<float>(random.Below(40)) * 0.25f : static_cast<float>(random.Unit() * 10);
+			const float duration = random.Below(4) == 0 ? 0 : static_cast<float>(random.Unit() * 2.5 - 0.5);
+			pattern.add_event(start, haptic_event_type::haptic_continuous, duration, -1);
 		}
-	}
-	void _print(int indent, std::ostream& os)const {
-		if (auto* array = std::get_if<JsonArray>(&value)) {
-			if (array->empty() == true) {
-				os << "[]";
-			}
-			else {
-				os << "[\n";
-				_print_indent(indent + 1, os);
-				int count = 0;
-				for (const auto& e : *array) {
-					e._print(indent + 1, os);
-					count++;
-					if (count != array->size()) {
-						os << ",\n";
-						_print_indent(indent + 1, os);
-					}
-					else {
-						os << "\n";
-						_print_indent(indent, os);
-
-					}
-				}
-				os << "]";
-			}
+		const auto view = pattern.view();
+		const HapticTimeline timeline(view);
+		std::vector<uint32_t> order(n);
+		for (uint32_t i = 0; i < n; i++) {
+			order[i] = i;
 		}
-		else if (auto* dict = std::get_if<JsonDict>(&value)) {
-			if (dict->empty() == true) {
-				os << "{}";
-			}
-			else {
-				os << "{\n";
-				_print_indent(indent + 1, os);
-				auto count = 0;
-				for (auto& e : *dict) {
-					os << "\"" << e.first << "\": ";
-					e.second._print(indent + 1, os);
-					count++;
-					if (count != dict->size()) {
-						os << ",\n";
-						_print_indent(indent + 1, os);
-					}
-					else {
-						os << "\n";
-						_print_indent(indent, os);
-					}
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return view.event_time[a] < view.event_time[b]; });
+		std::vector<haptic_window> windows;
+		for (int k = 0; k < 200; k++) {
+			const float begin = static_cast<float>(random.Unit() * 12 - 1);
+			const float length = random.Below(4) == 0 ? static_cast<float>(random.Below(3)) * 0.25f : static_cast<float>(random.Unit() * 3);
+			windows.push_back({ begin, begin + length });
+		}
+		std::vector<uint32_t> found, expected, events, offsets;
+		timeline.events_in(span<const haptic_window>(windows.data(), windows.size()), events, offsets);
+		for (size_t k = 0; k < windows.size(); k++) {
+			const auto [begin, end] = windows[k];
+			expected.clear();
+			for (const auto i : order) {
+				const float start = view.event_time[i];
+				if (start < end && (start >= begin || start + (std::max)(view.event_duration[i], 0.0f) > begin)) {
+					expected.push_back(i);
 				}
-				os << "}";
 			}
-		}
-		else if (auto* boolean = std::get_if<JsonBoolean>(&value)) {
-			os << *boolean ? "true" : "false";
-		}
-		else if (auto* number = std::get_if<JsonNumber>(&value)) {
-			os << *number;
-		}
-		else if (auto* text = std::get_if<JsonString>(&value)) {
-			os << '"' << *text << '"';
-			//os << '"';
-			//for (auto c : *text) {
-			//	if (c == '"') {
-			//		os << "\\\"";
-			//	}
-			//	else {
-			//		os << c;
-			//	}
-			//}
-			//os << '"';
-		}
-		else if (auto* null = std::get_if<JsonNull>(&value)) {
-			os << "null";
-		}
-	}
-};
-
-struct json_parser {
-	size_t pos;
-	std::string j;
-	json_parser() :pos(0) {}
-	json_parser(std::string json) :pos(0), j(json) {}
-	job parse() {
-		pos = 0;
-		return parse_value();
-	}
-
-private:
-	void parse_whitespace() {
-		while (j[pos] == '\n' ||
-			j[pos] == '\t' ||
-			j[pos] == '\r' ||
-			j[pos] == ' ')
-			pos++;
-	}
-
-	char next() {
-		parse_whitespace();
-		if (pos >= j.length())return '\0';
-		pos++;
-		return j[pos];
-	}
-
-	job parse_null() {
-		parse_whitespace();
-		if (expect("null")) {
-			return job();
-		}
-		throw std::runtime_error("null error");
-	}
-
-	bool expect(const char* s) {
-		parse_whitespace();
-		for (auto p = s; *p; p++) {
-			if (*p != j[pos++]) {
+			found.clear();
+			if (timeline.events_in(begin, end, found) != expected.size() || found != expected ||
+				!std::equal(events.begin() + offsets[k], events.begin() + offsets[k + 1], expected.begin(), expected.end())) {
 				return false;
 			}
 		}
-		return true;
 	}
+	return true;
+}
 
-	bool expect(char e) {
-		parse_whitespace();
-		if (j[pos] == e) {
-			pos++;
-			return true;
+// render_track must agree with interpolate() at every sample: buffers shorter than a vector, tails,
+// tracks without points or with one point, and points closer together than a sample. Samples that
+// land on the first point are skipped, there the fallback and the first value meet. interpolate()
+// takes the time as a float, so on steep segments it is only as exact as the rounding of the time.
+bool check_render() {
+	GenRandom random(7);
+	std::vector<float> times, values, out;
+	for (int k = 0; k < 500; k++) {
+		const size_t points = k < 50 ? k % 3 : random.Below(40);
+		times.clear();
+		values.clear();
+		float time = static_cast<float>(random.Unit() * 0.5);
+		for (size_t i = 0; i < points; i++) {
+			times.push_back(time);
+			values.push_back(static_cast<float>(random.Unit()));
+			time += random.Below(4) == 0 ? 1e-4f : static_cast<float>(random.Unit() * 0.2 + 1e-3);
 		}
-		throw std::runtime_error("expect error");
-	}
-
-	char peek() {
-		parse_whitespace();
-		return j[pos];
-	}
-
-	char* peek_ptr() {
-		parse_whitespace();
-		return &j[pos];
-	}
-
-	JsonDict parse_dict() {
-		expect('{');
-		JsonDict dict;
-		//dict.reserve(50);
-		while (peek() != '}') {
-			auto key = parse_string();
-			expect(':');
-			auto value = parse_value();
-			if (dict.find(key) == dict.end()) {
-				dict.emplace(std::move(key), std::move(value));
-			}
-			else {
-				throw std::runtime_error("duplicate key");
-			}
-			if (peek() == ',') {
-				next();
-			}
-			else {
-				expect('}');
-				return dict;
-			}
+		double steepest = 0;
+		for (size_t i = 1; i < points; i++) {
+			steepest = (std::max)(steepest, std::abs(values[i] - values[i - 1]) / (double(times[i]) - times[i - 1]));
 		}
-		expect('}');
-		return dict;
-	}
-
-	JsonArray parse_array() {
-		expect('[');
-		JsonArray array;
-		// array.reserve(50);
-		while (peek() != ']') {
-			auto val = parse_value();
-			array.push_back(std::move(val));
-			if (peek() != ',') {
-				expect(']');
-				return array;
+		const haptic_track track{ { times.data(), times.size() }, { values.data(), values.size() } };
+		const size_t count = k < 100 ? k % 20 : random.Below(3000);
+		const float start = static_cast<float>(random.Unit() * 0.5 - 0.1);
+		const float rate = random.Below(2) ? 48000.0f : static_cast<float>(100 + random.Below(2000));
+		const float fallback = -1;
+		out.assign(count + 1, 12345.0f);
+		render_track(track, start, rate, fallback, out.data(), count);
+		if (out[count] != 12345.0f) {
+			return false;	// wrote past the end
+		}
+		for (size_t j = 0; j < count; j++) {
+			const double t = start + j / double(rate);
+			if (!times.empty() && std::abs(t - times[0]) < 1e-5) {
+				continue;
 			}
-			else {
-				next(); //,
+			const double rounding = steepest * std::abs(t) * std::numeric_limits<float>::epsilon();
+			if (std::abs(out[j] - interpolate(track, static_cast<float>(t), fallback)) > 1e-4 + rounding) {
+				return false;
 			}
 		}
-		expect(']');
-		return array;
 	}
-
-	char next2() {
-		if (pos >= j.length())return '\0';
-		pos++;
-		return j[pos];
+	// Curves: no samples without points, the single value through the point with one
+	const float time = 0.25f, value = 0.75f;
+	const haptic_curve empty{ 0, {}, {}, {} }, single{ 0, {}, { &time, 1 }, { &value, 1 } };
+	if (curve_sample_count(empty, 100) != 0 || curve_sample_count(single, 100) != 26) {
+		return false;
 	}
+	out.assign(27, 12345.0f);
+	render_curve(empty, 100, out.data(), 0);
+	render_curve(single, 100, out.data(), 26);
+	return std::all_of(out.begin(), out.end() - 1, [&](float v) { return v == value; }) && out.back() == 12345.0f;
+}
 
-	JsonString parse_string() {
-		expect('"');
-		auto begin = pos;
-		//JsonString text;
-		while (j[pos] != '"') {
-			if (j[pos] != '\\') {
-				pos++;
-			}
-			else {
-				// escape char
-				// text.append(&j[begin], &j[pos]);
-				if (char c = next2()) {
-					// text.push_back(c);
-				}
-				else {
-					throw std::runtime_error("\\0 encountered.");
-				}
-				pos++;
-				begin = pos;
-			}
-		}
-		// text.append(&j[begin], &j[pos]);
-		JsonString text(&j[begin], pos - begin);
-		expect('"');
-		return text;
-	}
+// Failures must point at the character that caused them, not at whitespace next to it
+bool check_error_offsets() {
+	parse_options shallow;
+	shallow.max_depth = 2;
+	const auto fails_at = [](auto&& result, error_kind kind, size_t offset) {
+		return !result && result.error().kind == kind && result.error().offset == offset;
+	};
+	json_parser trailing("[1] x");
+	json_parser spaces("[1] \r\n");
+	json_parser deep("[ [ [ 1 ] ] ]", shallow);
+	json_struct_parser skipped(R"({"x":[ [ [1]]]})", shallow);
+	json_struct_parser decoded(R"({"a":1} x)");
+	ahap_parser pattern(R"({"Version":1,"Pattern":[]} garbage ]]])");
+	const auto duplicate_at = [&](const char* text, size_t offset) {
+		json_parser plain(text);
+		basic_json_parser<heap_vector_interned_policy> interned(text);
+		basic_json_parser<heap_vector_shaped_policy> shaped(text);
+		return fails_at(plain.try_parse(), error_kind::duplicate_key, offset) && fails_at(interned.try_parse(), error_kind::duplicate_key, offset) &&
+			fails_at(shaped.try_parse(), error_kind::duplicate_key, offset);
+	};
+	return fails_at(trailing.try_parse(), error_kind::trailing_characters, 4) && spaces.try_parse() &&
+		fails_at(deep.try_parse(), error_kind::depth_exceeded, 4) &&
+		fails_at(skipped.try_parse<integer_bounds>(), error_kind::depth_exceeded, 7) &&
+		fails_at(decoded.try_parse<integer_bounds>(), error_kind::trailing_characters, 8) &&
+		fails_at(pattern.try_parse(), error_kind::trailing_characters, 27) &&
+		duplicate_at(R"({"a":1,"a":2})", 8) && duplicate_at(R"({"a":1,"\u0061":2})", 8) && duplicate_at(R"({"a":1, "b":{}, "\u0061":2})", 17);
+}
 
-	job parse_value() {
-		switch (peek()) {
-		case 'n':return parse_null();
-		case 'f':
-		case 't':return parse_boolean();
-		case '"':return parse_string();
-		case '{':return parse_dict();
-		case '[':return parse_array();
-		default:
-		{
-			if (_is_digit(peek())) {
-				return parse_number();
-			}
-			throw std::runtime_error("parse value error\n");
-		}
+// Empty containers count toward the depth, and max_depth cannot be raised past MaxDepth
+bool check_depth_limit() {
+	const auto nested = [](size_t depth) { return std::string(depth, '[') + std::string(depth, ']'); };
+	parse_options deeper;
+	deeper.max_depth = 5000;
+	json_parser limit(nested(parse_options::MaxDepth));
+	json_parser past(nested(parse_options::MaxDepth + 1));
+	json_parser raised(nested(2000), deeper);
+	json_struct_parser skipped("{\"x\":" + nested(parse_options::MaxDepth + 1) + "}");
+	const auto depth_error = [](const json_error& error, size_t offset) { return error.kind == error_kind::depth_exceeded && error.offset == offset; };
+	auto ok = limit.try_parse().has_value();
+	auto a = past.try_parse();
+	auto b = raised.try_parse();
+	auto c = skipped.try_parse<integer_bounds>();
+	return ok && !a && depth_error(a.error(), parse_options::MaxDepth) && !b && depth_error(b.error(), parse_options::MaxDepth) &&
+		!c && depth_error(c.error(), 5 + parse_options::MaxDepth - 1);	// the struct is the first level
+}
+
+// Trees built by hand can nest far deeper than the parser allows; writing and destroying them must not recurse
+bool check_deep_tree() {
+	constexpr size_t Depth = 200000;
+	std::string text;
+	{
+		job doc = JsonArray();
+		for (size_t i = 1; i < Depth; i++) {
+			JsonArray outer;
+			outer.push_back(std::move(doc));
+			doc = job(std::move(outer));
 		}
+		json_writer writer;
+		text = writer.write(doc);
 	}
+	return text == std::string(Depth, '[') + std::string(Depth, ']');
+}
 
-	job parse_number() {
-		auto p = peek_ptr();
-		char* end;
-		auto ret = std::strtod(p, &end);
-		if (end == p) {
-			throw std::runtime_error("parse number error\n");
-			return job();
-		}
-		else {
-			pos += (end - p);
-			return job(ret);
+// Looking up keys a document does not have must not add them to the shared key table
+template<class Policy>
+bool check_key_lookup() {
+	json_reset_keys();	// earlier checks may have interned the same keys
+	bool ok;
+	{
+		basic_json_parser<Policy> jp(R"({"a":1,"b":{"a":2}})");
+		auto doc = jp.try_parse();
+		if (!doc) {
+			return false;
 		}
-	}
+		const auto& dict = std::get<typename basic_job<Policy>::dict_type>(doc->value);
+		const size_t known = g_keys.size();
+		ok = known == 2 && dict.find(JsonString("missing")) == dict.end() && dict.find(JsonString("a")) != dict.end() && g_keys.size() == known;
+		ok = ok && JsonKey() != JsonKey(JsonString("a")) && JsonString(JsonKey()).empty();
+		(*doc)["c"] = basic_job<Policy>(3.0);
+		ok = ok && g_keys.size() == known + 1 && (*doc)["c"].template as<JsonNumber>() == 3;
+	}
+	json_reset_keys();
+	return ok && g_keys.size() == 0;
+}
 
-	bool _is_digit(char c) {
-		return std::isdigit(c) || c == '+' || c == '-';
+// Writes the same events into one contiguous buffer and through a sink with the smallest ring the
+// writer allows, and compares the bytes
+template<class Fn>
+bool same_through_sink(write_options options, Fn&& events) {
+	json_writer direct(options);
+	events(direct);
+	std::string streamed;
+	{
+		json_writer sink([&](const std::string_view* chunks, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				streamed += chunks[i];
+			}
+			return true;
+			}, options, 0, 1);
+		events(sink);
+		sink.flush();
 	}
+	return streamed == direct.view();
+}
 
-	job parse_boolean() {
-		if (peek() == 't') {  // true
-			if (expect("true")) {
-				return job(true);
-			}
+// Indentation of 100 spaces per level passes the size of a ring buffer at level 164
+bool check_sink_nesting() {
+	return same_through_sink({ 100, ' ' }, [](json_writer& writer) {
+		for (int i = 0; i < 400; i++) {
+			writer.begin_array();
 		}
-		else if (peek() == 'f') {  // false
-			if (expect("false")) {
-				return job(false);
-			}
+		writer.value(1.0);
+		for (int i = 0; i < 400; i++) {
+			writer.end_array();
 		}
-		throw std::runtime_error("parse boolean error");
-	}
-
-};
-
-std::istream& operator>>(std::istream& ifs, json_parser& jp) {
-	jp = json_parser(std::string{ std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{} });
-	return ifs;
+		});
 }
 
+// Lazy strings and numbers are copied as read, each longer than the smallest ring buffer here
+bool check_sink_raw_text() {
+	std::string escapes;
+	for (int i = 0; i < 20000; i++) {
+		escapes += "\\n";
+	}
+	const std::string text = "[\"" + escapes + "\"," + "1" + std::string(20000, '0') + "]";
+	parse_options options;
+	options.lazy_numbers = true;
+	options.lazy_strings = true;
+	json_parser jp(text, options);
+	auto doc = jp.try_parse();
+	return doc && same_through_sink({}, [&](json_writer& writer) { writer.write(*doc); });
+}
 
-int main()
+int main(int argc, char** argv)
 {
-	std::vector<std::string> filenames = {
-		"data\\test1.json",
-		"data\\test2.json",
-		"data\\Boing.ahap"
-		"data\\Drums.ahap",
-		"data\\Gravel.ahap",
-		"data\\Heartbeats.ahap",
-		"data\\Inflate.ahap",
-		"data\\Oscillate.ahap",
-		"data\\Rumble.ahap"
-		"data\\canada.json",
-		"data\\citm_catelog.json",
-		"data\\twitter.json",
-		"data\\pass01.json",
-		"data\\pass02.json",
-		"data\\pass03.json",
-	};
-
+	const std::filesystem::path dir = argc > 1 ? argv[1] : JPARSER_DATA_DIR;
+	std::vector<std::filesystem::path> filenames;
+	for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+		if (entry.is_regular_file()) {
+			filenames.push_back(entry.path());
+		}
+	}
+	std::sort(filenames.begin(), filenames.end());
 
+	int failures = 0;
+	json_writer writer;
 	for (const auto& each : filenames) {
-		std::ifstream ifs(each, std::ios::in);
-		if (ifs.is_open() == true) {
-			json_parser jp;
-			ifs >> jp;
-			try {
-				ankerl::nanobench::Bench().minEpochIterations(200).run(each, [&] {
-					//jp.j = R"("\\")";
-					auto job = jp.parse();
-					std::stringstream ss1;
-					job.pretty_print(ss1);
-					ankerl::nanobench::doNotOptimizeAway(job);
-					json_parser jp2;
-					ss1 >> jp2;
-					auto job2 = jp2.parse();
-					std::stringstream ss2;
-					job2.pretty_print(ss2);
-					g_arena.Reset();
-					}
-				);
-			}
-			catch (std::exception& e) {
-				std::cout << each << " exeption: " << e.what() << std::endl;
-			}
-
+		std::ifstream ifs(each, std::ios::in | std::ios::binary);
+		json_parser jp;
+		ifs >> jp;
+		auto doc = jp.try_parse();
+		if (!doc) {
+			std::cout << "error    " << each.filename().string() << ": " << doc.error() << std::endl;
+			failures++;
+			continue;
 		}
+		const std::string text(writer.write(*doc));
+		json_parser jp2(text);
+		auto doc2 = jp2.try_parse();
+		// Packed numeric arrays must not change the output either
+		parse_options packOptions;
+		packOptions.pack_numbers = true;
+		json_parser jp3(text, packOptions);
+		auto doc3 = jp3.try_parse();
+		// Nor numbers and strings kept as text
+		parse_options lazyOptions;
+		lazyOptions.lazy_numbers = true;
+		lazyOptions.lazy_strings = true;
+		json_parser jp4(text, lazyOptions);
+		auto doc4 = jp4.try_parse();
+		const bool same = doc2 && writer.write(*doc2) == text && doc3 && writer.write(*doc3) == text && doc4 && writer.write(*doc4) == text;
+		std::cout << (same ? "ok       " : "mismatch ") << each.filename().string() << std::endl;
+		failures += !same;
+		g_arena.Reset();
+	}
+
+	const std::pair<const char*, bool> checks[] = {
+		{ "nesting deeper than a sink buffer", check_sink_nesting() },
+		{ "lazy text longer than a sink buffer", check_sink_raw_text() },
+		{ "integers at the edges of their range", check_integer_bounds() },
+		{ "typed decoding limited in depth", check_typed_depth() },
+		{ "invalid utf-8 rejected", check_utf8() },
+		{ "timeline queries match a linear scan", check_timeline() },
+		{ "rendered ramps match interpolation", check_render() },
+		{ "errors at the offending character", check_error_offsets() },
+		{ "nesting limited to MaxDepth", check_depth_limit() },
+		{ "deep trees written and destroyed", check_deep_tree() },
+		{ "lookups leave interned keys alone", check_key_lookup<heap_vector_interned_policy>() },
+		{ "lookups leave shaped keys alone", check_key_lookup<heap_vector_shaped_policy>() },
+	};
+	for (const auto& [name, ok] : checks) {
+		std::cout << (ok ? "ok       " : "failed   ") << name << std::endl;
+		failures += !ok;
 	}
 	g_arena.Release();
+	return failures == 0 ? 0 : 1;
 }
@@ -0,0 +1,2704 @@
+// jparser.h : The parser library: arena, DOM, parser and writer.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <map>
+#include <list>
+#include <deque>
+#include <variant>
+#include <type_traits>
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <charconv>
+#include <limits>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JPARSER_AVX2 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define JPARSER_SSSE3 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JPARSER_SSE2 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#if !defined(JPARSER_NO_EXCEPTIONS) && !defined(__cpp_exceptions) && !defined(_CPPUNWIND)
+#define JPARSER_NO_EXCEPTIONS 1
+#endif
+#if defined(JPARSER_NO_EXCEPTIONS)
+#include <cstdio>
+#include <cstdlib>
+#define JPARSER_THROW(e) (std::fputs((e).what(), stderr), std::fputc('\n', stderr), std::abort())
+#else
+#define JPARSER_THROW(e) throw e
+#endif
+
+constexpr std::size_t CashLine = 64;
+
+inline void* AllocAligned(std::size_t size, int align) {
+#if defined(_WIN32)
+	return _aligned_malloc(size, align);
+#else
+	void* ptr = nullptr;
+	return posix_memalign(&ptr, align, size) == 0 ? ptr : nullptr;
+#endif
+}
+
+inline void FreeAligned(void* ptr) {
+#if defined(_WIN32)
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+template <typename T>
+T* AllocAligned(std::size_t n)
+{
+	return (T*)(AllocAligned(sizeof(T) * n, 64));
+}
+
+// A region-based memory manager "Fast allocation and deallocation of memory based on object lifetimes"
+template <int nCashLine = 64>
+class DataArena
+{
+	const size_t m_blockSize;
+	size_t m_currentBlockPos;
+	size_t m_currentAllocBlockSize;
+	uint8_t* m_currentBlock;
+	size_t m_fragmentSize;
+	size_t m_allocCount;
+	size_t m_allocBytes;
+	//std::vector<int> m_pos;
+	std::list<std::pair<uint8_t*, int>> m_used;
+	std::list<std::pair<uint8_t*, int>> m_available;
+
+public:
+	explicit DataArena(size_t size = 1024 * 1024) :
+		m_blockSize(size),
+		m_currentAllocBlockSize(0),
+		m_currentBlock(nullptr),
+		m_currentBlockPos(0),
+		m_fragmentSize(0),
+		m_allocCount(0),
+		m_allocBytes(0)
+	{
+		// Default block is 1MB
+	}
+
+	DataArena(const DataArena& arena) = delete;
+	DataArena& operator=(const DataArena& arena) = delete;
+
+	DataArena(DataArena&& arena) noexcept :
+		m_blockSize(arena.m_blockSize), m_currentBlockPos(arena.m_currentBlockPos), m_currentAllocBlockSize(arena.m_currentAllocBlockSize), m_currentBlock(arena.m_currentBlock), m_fragmentSize(arena.m_fragmentSize), m_allocCount(arena.m_allocCount), m_allocBytes(arena.m_allocBytes), m_used(std::move(arena.m_used)), m_available(std::move(arena.m_available))
+	{
+		arena.m_currentBlock = nullptr;
+	}
+
+	DataArena& operator=(DataArena&& arena) noexcept
+	{
+		Release();	// Release memory
+		m_blockSize = arena.m_blockSize;
+		m_currentBlockPos = arena.m_currentBlockPos;
+		m_currentAllocBlockSize = arena.m_currentAllocBlockSize;
+		m_currentBlock = arena.m_currentBlock;
+		arena.m_currentBlock = nullptr;
+		m_fragmentSize = arena.m_fragmentSize;
+		m_allocCount = arena.m_allocCount;
+		m_allocBytes = arena.m_allocBytes;
+		m_used = std::move(arena.m_used);
+		m_available = std::move(arena.m_available);
+		return *this;
+	}
+
+	void* Alloc(size_t bytes)
+	{
+		const auto align = alignof(std::max_align_t);
+		bytes = (bytes + align - 1) & ~(align - 1);	 // Find a proper size to match the aligned boundary
+		m_allocCount++;
+		m_allocBytes += bytes;
+		if (m_currentBlockPos + bytes > m_currentAllocBlockSize) {
+			// Put into used list. A fragment generates.
+			if (m_currentBlock) {
+				m_used.push_back(std::make_pair(m_currentBlock, m_currentAllocBlockSize));
+				m_fragmentSize += m_currentAllocBlockSize - m_currentBlockPos;
+				m_currentBlock = nullptr;
+				m_currentBlockPos = 0;
+				//std::cout << "Current block can not accommodate this size, put it into used list.\n";
+			}
+
+			// Try to find available block
+			for (auto it = m_available.begin(); it != m_available.end(); ++it) {
+				if (bytes <= it->second) {
+					m_currentBlock = it->first;
+					m_currentAllocBlockSize = it->second;
+					m_currentBlockPos = 0;
+					m_available.erase(it);
+					break;
+				}
+			}
+
+			if (!m_currentBlock) {
+				// Available space can not be found. Allocates new memory
+				m_currentAllocBlockSize = (std::max)(bytes, m_blockSize);
+				m_currentBlock = static_cast<uint8_t*>(AllocAligned(m_currentAllocBlockSize, nCashLine));
+				if (m_currentBlock == nullptr) {
+					return nullptr;
+				}
+				m_currentBlockPos = 0;
+			}
+			m_currentBlockPos = 0;
+		}
+		const auto ptr = m_currentBlock + m_currentBlockPos;
+		m_currentBlockPos += bytes;
+		return ptr;
+	}
+
+	/**
+	 * \brief Allocate for \a n objects for type \a T, runs constructor depends on \a construct on it and return its pointer
+	 *
+	 * \note For safety, this function should be check if the \a T is a type of POD or trivial.
+	 *		 Maybe it can be checked by \a std::is_trivial or \a std::is_pod(deprecated).
+	 *		 This issued will be addressed later.
+	 *
+	 * \sa Reset()
+	 */
+	template <typename T>
+	T* Alloc(size_t n, bool construct = true)
+	{
+		const auto ptr = static_cast<T*>(Alloc(n * sizeof(T)));
+		if (ptr == nullptr)
+			return nullptr;
+		if (construct)
+			for (auto i = 0; i < n; i++)
+				new (&ptr[i]) T();
+		return ptr;
+	}
+
+	template <typename T, typename... Args>
+	T* AllocConstruct(Args &&... args)
+	{
+		const auto ptr = static_cast<T*>(Alloc(sizeof(T)));
+		if (ptr == nullptr) return nullptr;
+		new (ptr) T(std::forward<Args>(args)...);
+		return ptr;
+	}
+
+	void Release()
+	{
+		for (auto it = m_used.begin(); it != m_used.end(); ++it) FreeAligned(it->first);
+		for (auto it = m_available.begin(); it != m_available.end(); ++it) FreeAligned(it->first);
+		FreeAligned(m_currentBlock);
+		m_used.clear();
+		m_available.clear();
+		m_currentBlock = nullptr;
+		m_currentBlockPos = 0;
+		m_currentAllocBlockSize = 0;
+		m_fragmentSize = 0;
+	}
+
+	void Shrink()
+	{
+		for (auto it = m_available.begin(); it != m_available.end(); ++it) FreeAligned(it->first);
+		m_available.clear();
+	}
+
+	void Reset()
+	{
+		m_currentBlockPos = 0;
+		m_fragmentSize = 0;
+		m_available.splice(m_available.begin(), m_used);
+	}
+
+	size_t TotalAllocated() const
+	{
+		auto alloc = m_currentAllocBlockSize;
+		for (auto it = m_used.begin(); it != m_used.end(); ++it) alloc += it->second;
+		for (auto it = m_available.begin(); it != m_available.end(); ++it) alloc += it->second;
+		return alloc;
+	}
+
+	size_t FragmentSize() const
+	{
+		return m_fragmentSize;
+	}
+
+	double FragmentRate() const
+	{
+		return static_cast<double>(m_fragmentSize) / TotalAllocated();
+	}
+
+	/**
+	 * \brief Number of Alloc() calls and their aligned bytes since construction. Reset() keeps them,
+	 *		  so the cost of one operation is the difference of two readings.
+	 */
+	size_t AllocCount() const
+	{
+		return m_allocCount;
+	}
+
+	size_t AllocBytes() const
+	{
+		return m_allocBytes;
+	}
+
+	~DataArena()
+	{
+		Release();
+	}
+};
+
+using Arena64 = DataArena<64>;
+
+// Block size of g_arena, one block is allocated when the arena is first used
+#ifndef JPARSER_ARENA_SIZE
+#define JPARSER_ARENA_SIZE (1024 * 1024 * 1024)
+#endif
+
+// One arena for the program, so arena-backed documents are built on one thread at a time. With
+// JPARSER_ARENA_THREAD_LOCAL defined every thread gets its own; a document then lives in the arena
+// of the thread that parsed it and must not outlive that thread or its Reset().
+#if defined(JPARSER_ARENA_THREAD_LOCAL)
+inline thread_local Arena64 g_arena(JPARSER_ARENA_SIZE);
+#else
+inline Arena64 g_arena(JPARSER_ARENA_SIZE);
+#endif
+
+template<class T>
+struct ArenaAllocator
+{
+	typedef T value_type;
+
+	// Arena64* m_arena = nullptr;
+	ArenaAllocator() = default;
+
+	template<class U>
+	constexpr ArenaAllocator(const ArenaAllocator <U>&) noexcept {}
+
+	T* allocate(std::size_t n)
+	{
+		return (T*)g_arena.Alloc(n * sizeof(T));
+		//return (T*)std::malloc(n);
+	}
+
+	void deallocate(T* p, std::size_t n) noexcept
+	{
+		//return std::free(p);
+		//std::cout << "dealloate: " << n << std::endl;;
+	}
+};
+
+template<class T, class U>
+inline bool operator==(const ArenaAllocator <T>&, const ArenaAllocator <U>&) {
+	return true;
+}
+
+template<class T, class U>
+inline bool operator!=(const ArenaAllocator <T>&, const ArenaAllocator <U>&) {
+	return false;
+}
+
+
+inline uint32_t trailing_zeros(uint32_t mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// UTF-8 validation
+/*
+ * Vectorized validator after Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte".
+ * Every byte pair is classified with three 16-entry nibble lookups whose AND is non-zero exactly when
+ * the pair is illegal (overlong, surrogate, too large, missing or stray continuation). The only
+ * case the lookups cannot see, a 3rd/4th continuation byte, is checked against prev2/prev3 lead bytes.
+ */
+#if defined(JPARSER_AVX2) || defined(JPARSER_SSSE3)
+
+#if defined(JPARSER_AVX2)
+using simd_u8 = __m256i;
+constexpr std::size_t SimdWidth = 32;
+inline simd_u8 simd_load(const void* p) { return _mm256_loadu_si256(static_cast<const __m256i*>(p)); }
+inline simd_u8 simd_splat(uint8_t v) { return _mm256_set1_epi8(static_cast<char>(v)); }
+inline simd_u8 simd_table(const uint8_t* t) { return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t))); }
+inline simd_u8 simd_and(simd_u8 a, simd_u8 b) { return _mm256_and_si256(a, b); }
+inline simd_u8 simd_or(simd_u8 a, simd_u8 b) { return _mm256_or_si256(a, b); }
+inline simd_u8 simd_xor(simd_u8 a, simd_u8 b) { return _mm256_xor_si256(a, b); }
+inline simd_u8 simd_subs(simd_u8 a, simd_u8 b) { return _mm256_subs_epu8(a, b); }
+inline simd_u8 simd_lookup(simd_u8 table, simd_u8 index) { return _mm256_shuffle_epi8(table, index); }
+inline simd_u8 simd_shr4(simd_u8 a) { return _mm256_and_si256(_mm256_srli_epi16(a, 4), simd_splat(0x0F)); }
+inline bool simd_is_ascii(simd_u8 a) { return _mm256_movemask_epi8(a) == 0; }
+inline bool simd_any(simd_u8 a) { return !_mm256_testz_si256(a, a); }
+// Bytes of input shifted right by N, pulling in the last N bytes of prev
+template <int N>
+inline simd_u8 simd_prev(simd_u8 input, simd_u8 prev) { return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N); }
+#else
+using simd_u8 = __m128i;
+constexpr std::size_t SimdWidth = 16;
+inline simd_u8 simd_load(const void* p) { return _mm_loadu_si128(static_cast<const __m128i*>(p)); }
+inline simd_u8 simd_splat(uint8_t v) { return _mm_set1_epi8(static_cast<char>(v)); }
+inline simd_u8 simd_table(const uint8_t* t) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(t)); }
+inline simd_u8 simd_and(simd_u8 a, simd_u8 b) { return _mm_and_si128(a, b); }
+inline simd_u8 simd_or(simd_u8 a, simd_u8 b) { return _mm_or_si128(a, b); }
+inline simd_u8 simd_xor(simd_u8 a, simd_u8 b) { return _mm_xor_si128(a, b); }
+inline simd_u8 simd_subs(simd_u8 a, simd_u8 b) { return _mm_subs_epu8(a, b); }
+inline simd_u8 simd_lookup(simd_u8 table, simd_u8 index) { return _mm_shuffle_epi8(table, index); }
+inline simd_u8 simd_shr4(simd_u8 a) { return _mm_and_si128(_mm_srli_epi16(a, 4), simd_splat(0x0F)); }
+inline bool simd_is_ascii(simd_u8 a) { return _mm_movemask_epi8(a) == 0; }
+inline bool simd_any(simd_u8 a) { return _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_setzero_si128())) != 0xFFFF; }
+template <int N>
+inline simd_u8 simd_prev(simd_u8 input, simd_u8 prev) { return _mm_alignr_epi8(input, prev, 16 - N); }
+#endif
+
+class Utf8Checker
+{
+	// Error classes of a (byte 1, byte 2) pair
+	static constexpr uint8_t TooShort = 1 << 0;		// 11______ 0_______ / 11______ 11______
+	static constexpr uint8_t TooLong = 1 << 1;		// 0_______ 10______
+	static constexpr uint8_t Overlong3 = 1 << 2;	// 11100000 100_____
+	static constexpr uint8_t TooLarge = 1 << 3;		// 11110100 1001____ / 11110100 101_____ / 11110101+ 10______
+	static constexpr uint8_t Surrogate = 1 << 4;	// 11101101 101_____
+	static constexpr uint8_t Overlong2 = 1 << 5;	// 1100000_ 10______
+	static constexpr uint8_t TooLarge1000 = 1 << 6; // 11110101 1000____ / 1111011_ 1000____ / 11111___ 1000____
+	static constexpr uint8_t Overlong4 = 1 << 6;	// 11110000 1000____
+	static constexpr uint8_t TwoConts = 1 << 7;		// 10______ 10______
+	static constexpr uint8_t Carry = TooShort | TooLong | TwoConts;
+
+	simd_u8 m_error = simd_splat(0);
+	simd_u8 m_prevInput = simd_splat(0);
+	simd_u8 m_prevIncomplete = simd_splat(0);
+
+	static simd_u8 SpecialCases(simd_u8 input, simd_u8 prev1)
+	{
+		alignas(16) static constexpr uint8_t byte1High[16] = {
+			TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+			TwoConts, TwoConts, TwoConts, TwoConts,
+			TooShort | Overlong2,
+			TooShort,
+			TooShort | Overlong3 | Surrogate,
+			TooShort | TooLarge | TooLarge1000 | Overlong4 };
+		alignas(16) static constexpr uint8_t byte1Low[16] = {
+			Carry | Overlong3 | Overlong2 | Overlong4,
+			Carry | Overlong2,
+			Carry,
+			Carry,
+			Carry | TooLarge,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000 | Surrogate,
+			Carry | TooLarge | TooLarge1000,
+			Carry | TooLarge | TooLarge1000 };
+		alignas(16) static constexpr uint8_t byte2High[16] = {
+			TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+			TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4,
+			TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge,
+			TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+			TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+			TooShort, TooShort, TooShort, TooShort };
+		const auto b1h = simd_lookup(simd_table(byte1High), simd_shr4(prev1));
+		const auto b1l = simd_lookup(simd_table(byte1Low), simd_and(prev1, simd_splat(0x0F)));
+		const auto b2h = simd_lookup(simd_table(byte2High), simd_shr4(input));
+		return simd_and(simd_and(b1h, b1l), b2h);
+	}
+
+	static simd_u8 MultibyteLengths(simd_u8 input, simd_u8 prevInput, simd_u8 special)
+	{
+		// Only 111_____ survives as >= 0x80 two bytes back, only 1111____ three bytes back
+		const auto third = simd_subs(simd_prev<2>(input, prevInput), simd_splat(0xE0 - 0x80));
+		const auto fourth = simd_subs(simd_prev<3>(input, prevInput), simd_splat(0xF0 - 0x80));
+		const auto must23 = simd_and(simd_or(third, fourth), simd_splat(0x80));
+		return simd_xor(must23, special);
+	}
+
+	static simd_u8 Incomplete(simd_u8 input)
+	{
+		// A lead byte in the last 3 positions needs continuation bytes from the next block
+		alignas(32) static constexpr uint8_t maxValue[32] = {
+			255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+			255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1 };
+		return simd_subs(input, simd_load(maxValue + 32 - SimdWidth));
+	}
+
+public:
+	void Check(simd_u8 input)
+	{
+		if (simd_is_ascii(input)) {
+			m_error = simd_or(m_error, m_prevIncomplete);
+			return;
+		}
+		const auto special = SpecialCases(input, simd_prev<1>(input, m_prevInput));
+		m_error = simd_or(m_error, MultibyteLengths(input, m_prevInput, special));
+		m_prevIncomplete = Incomplete(input);
+		m_prevInput = input;
+	}
+
+	bool Finish()
+	{
+		m_error = simd_or(m_error, m_prevIncomplete);
+		return !simd_any(m_error);
+	}
+};
+
+inline bool utf8_validate(const char* data, std::size_t len) {
+	Utf8Checker checker;
+	std::size_t i = 0;
+	for (; i + SimdWidth <= len; i += SimdWidth) {
+		checker.Check(simd_load(data + i));
+	}
+	if (i < len) {
+		// Zero padding reads as ASCII, so a truncated sequence in the tail is still caught
+		alignas(32) uint8_t tail[SimdWidth] = {};
+		std::memcpy(tail, data + i, len - i);
+		checker.Check(simd_load(tail));
+	}
+	return checker.Finish();
+}
+
+#else
+
+inline bool utf8_validate(const char* data, std::size_t len) {
+	const auto s = reinterpret_cast<const uint8_t*>(data);
+	std::size_t i = 0;
+	while (i < len) {
+		const uint8_t c = s[i];
+		if (c < 0x80) {
+			i++;
+			continue;
+		}
+		std::size_t n;
+		uint32_t cp;
+		if (c >= 0xC2 && c <= 0xDF) { n = 1; cp = c & 0x1F; }
+		else if ((c & 0xF0) == 0xE0) { n = 2; cp = c & 0x0F; }
+		else if (c >= 0xF0 && c <= 0xF4) { n = 3; cp = c & 0x07; }
+		else return false;
+		if (len - i <= n) return false;
+		for (std::size_t k = 1; k <= n; k++) {
+			if ((s[i + k] & 0xC0) != 0x80) return false;
+			cp = (cp << 6) | (s[i + k] & 0x3F);
+		}
+		if (n == 2 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) return false;
+		if (n == 3 && (cp < 0x10000 || cp > 0x10FFFF)) return false;
+		i += n + 1;
+	}
+	return true;
+}
+
+#endif
+
+enum class object_type {
+	dict,
+	array,
+	text,
+	number,
+	null,
+	boolean
+};
+
+using JsonString = std::string_view;
+using JsonNumber = double;
+using JsonBoolean = bool;
+struct JsonNull {};
+
+// Stores every distinct key once and numbers them 0, 1, 2... in the order they were first seen.
+// The text is copied, so IDs stay valid after the document that introduced a key is gone.
+class json_key_table
+{
+	static constexpr size_t BlockSize = 16 * 1024;
+
+	std::vector<uint32_t> m_slots = std::vector<uint32_t>(64, 0);	// ID + 1 by hash, 0 for an empty slot
+	std::vector<JsonString> m_keys;
+	std::vector<uint64_t> m_hashes;
+	std::vector<std::unique_ptr<char[]>> m_blocks;	// key text
+	char* m_next = nullptr;
+	size_t m_free = 0;
+
+public:
+	static constexpr uint32_t NoKey = ~uint32_t(0);
+
+	json_key_table() = default;
+	json_key_table(const json_key_table&) = delete;
+	json_key_table& operator=(const json_key_table&) = delete;
+
+	// ID of key, added if the table does not have it yet
+	uint32_t intern(JsonString key) {
+		const auto hash = key_hash(key);
+		const auto slot = locate(key, hash);
+		if (m_slots[slot] != 0) {
+			return m_slots[slot] - 1;
+		}
+		const auto id = static_cast<uint32_t>(m_keys.size());
+		m_keys.push_back(store(key));
+		m_hashes.push_back(hash);
+		m_slots[slot] = id + 1;
+		if (m_keys.size() * 2 > m_slots.size()) {
+			rehash();
+		}
+		return id;
+	}
+
+	// ID of key, NoKey if it was never interned
+	uint32_t find(JsonString key) const {
+		const auto slot = m_slots[locate(key, key_hash(key))];
+		return slot != 0 ? slot - 1 : NoKey;
+	}
+
+	// Text of id, empty for NoKey
+	JsonString key(uint32_t id) const { return id != NoKey ? m_keys[id] : JsonString(); }
+	size_t size() const { return m_keys.size(); }
+
+	// Forgets every key. IDs handed out before must no longer be used.
+	void clear() {
+		m_slots.assign(64, 0);
+		m_keys.clear();
+		m_hashes.clear();
+		m_blocks.clear();
+		m_next = nullptr;
+		m_free = 0;
+	}
+
+private:
+	// Keys are short, so they are read a word at a time with overlapping loads instead of bytewise
+	static uint64_t key_hash(JsonString key) {
+		constexpr uint64_t K = 0x9e3779b97f4a7c15ull;
+		const auto load = [](const char* p, auto word) { std::memcpy(&word, p, sizeof(word)); return uint64_t(word); };
+		const char* p = key.data();
+		size_t n = key.size();
+		uint64_t h = n * K;
+		const auto mix = [&](uint64_t word) { h = (h ^ word) * K; h ^= h >> 32; };
+		if (n >= 8) {
+			for (; n > 8; n -= 8, p += 8) {
+				mix(load(p, uint64_t()));
+			}
+			mix(load(p + n - 8, uint64_t()));
+		}
+		else if (n >= 4) {
+			mix(load(p, uint32_t()) | load(p + n - 4, uint32_t()) << 32);
+		}
+		else if (n > 0) {
+			mix(uint64_t(uint8_t(p[0])) | uint64_t(uint8_t(p[n / 2])) << 8 | uint64_t(uint8_t(p[n - 1])) << 16);
+		}
+		return h;
+	}
+
+	// Slot holding key, or the empty slot where it belongs
+	size_t locate(JsonString key, uint64_t hash) const {
+		const auto mask = m_slots.size() - 1;
+		for (auto i = hash & mask;; i = (i + 1) & mask) {
+			const auto slot = m_slots[i];
+			if (slot == 0 || (m_hashes[slot - 1] == hash && m_keys[slot - 1] == key)) {
+				return i;
+			}
+		}
+	}
+
+	void rehash() {
+		m_slots.assign(m_slots.size() * 2, 0);
+		const auto mask = m_slots.size() - 1;
+		for (uint32_t id = 0; id < m_keys.size(); id++) {
+			auto i = m_hashes[id] & mask;
+			while (m_slots[i] != 0) {
+				i = (i + 1) & mask;
+			}
+			m_slots[i] = id + 1;
+		}
+	}
+
+	JsonString store(JsonString key) {
+		if (m_blocks.empty() || key.size() > m_free) {
+			m_free = (std::max)(key.size(), BlockSize);
+			m_blocks.emplace_back(new char[m_free]);
+			m_next = m_blocks.back().get();
+		}
+		const JsonString text(m_next, key.size());
+		std::memcpy(m_next, key.data(), key.size());
+		m_next += key.size();
+		m_free -= key.size();
+		return text;
+	}
+};
+
+// Keys of the documents built with interned_dict or shaped_dict on this thread, shared by all of
+// them. IDs mean nothing on another thread, so such documents stay on the thread that built them.
+// The table only grows; json_reset_keys() empties it.
+inline thread_local json_key_table g_keys;
+
+// An object key as its ID in g_keys. Converting a JsonString only looks the key up, a key that was
+// never interned becomes NoKey and matches nothing, so lookups with unknown keys leave the table as
+// it is; intern() adds a key. Comparisons are on the ID.
+struct JsonKey {
+	uint32_t id = json_key_table::NoKey;
+
+	JsonKey() = default;
+	explicit JsonKey(uint32_t id) : id(id) {}
+	JsonKey(JsonString key) : id(g_keys.find(key)) {}
+	operator JsonString() const { return g_keys.key(id); }
+
+	static JsonKey intern(JsonString key) { return JsonKey(g_keys.intern(key)); }
+
+	friend bool operator==(JsonKey a, JsonKey b) { return a.id == b.id; }
+	friend bool operator!=(JsonKey a, JsonKey b) { return a.id != b.id; }
+	friend bool operator<(JsonKey a, JsonKey b) { return a.id < b.id; }
+};
+
+// Keys of a chain of shapes. A shape extends the buffer of its parent in place when it is the first
+// child to do so, so a run of shapes shares one buffer; large buffers also index keys by ID.
+struct json_shape_keys {
+	static constexpr size_t IndexFrom = 8;
+
+	std::vector<JsonKey> keys;
+	std::unordered_map<uint32_t, uint32_t> index;	// key ID to position, once there are more than IndexFrom keys
+
+	void append(JsonKey key) {
+		keys.push_back(key);
+		if (!index.empty()) {
+			index.emplace(key.id, static_cast<uint32_t>(keys.size() - 1));
+		}
+		else if (keys.size() > IndexFrom) {
+			for (uint32_t i = 0; i < keys.size(); i++) {
+				index.emplace(keys[i].id, i);
+			}
+		}
+	}
+};
+
+// The key sequence of an object, shared by every object with the same keys in the same order
+// (a hidden class). A value's position in the sequence is its slot.
+class json_shape
+{
+	friend class json_shape_table;
+
+	uint32_t m_id = 0;
+	uint32_t m_size = 0;
+	json_shape_keys* m_keys = nullptr;	// first m_size entries are the keys of this shape
+	json_shape* m_first = nullptr;		// ancestor with a single key
+	uint32_t m_largest = 0;				// for single-key shapes, the most keys any extension has
+	JsonKey m_nextKey;					// last transition taken, checked before the transition table
+	json_shape* m_next = nullptr;
+
+public:
+	size_t size() const { return m_size; }
+	JsonKey key(size_t slot) const { return m_keys->keys[slot]; }
+
+	// Slot of key, -1 if the shape does not have it
+	int slot(JsonKey key) const {
+		if (m_size <= json_shape_keys::IndexFrom || m_keys->index.empty()) {
+			for (uint32_t i = 0; i < m_size; i++) {
+				if (m_keys->keys[i] == key) {
+					return static_cast<int>(i);
+				}
+			}
+			return -1;
+		}
+		const auto it = m_keys->index.find(key.id);
+		return it != m_keys->index.end() && it->second < m_size ? static_cast<int>(it->second) : -1;
+	}
+
+	// Most keys seen on an object that starts with the same key, a good first capacity for its values
+	size_t expected_size() const { return m_first ? m_first->m_largest : 0; }
+};
+
+// Every shape seen on this thread, as a tree of transitions from the empty shape by one key each
+class json_shape_table
+{
+	std::deque<json_shape> m_shapes;
+	std::deque<json_shape_keys> m_keys;
+	std::unordered_map<uint64_t, json_shape*> m_transitions;	// (shape ID << 32 | key ID) to the extended shape
+
+public:
+	json_shape_table() { clear(); }
+	json_shape_table(const json_shape_table&) = delete;
+	json_shape_table& operator=(const json_shape_table&) = delete;
+
+	json_shape* empty() { return &m_shapes.front(); }
+	size_t size() const { return m_shapes.size(); }
+
+	// Shape with the keys of shape followed by key, nullptr if shape already has key
+	json_shape* extend(json_shape* shape, JsonKey key) {
+		if (shape->m_next && shape->m_nextKey == key) {
+			return shape->m_next;
+		}
+		const auto [it, added] = m_transitions.try_emplace(uint64_t(shape->m_id) << 32 | key.id, nullptr);
+		if (added) {
+			if (shape->slot(key) >= 0) {
+				m_transitions.erase(it);
+				return nullptr;
+			}
+			it->second = add(shape, key);
+		}
+		shape->m_nextKey = key;
+		shape->m_next = it->second;
+		return it->second;
+	}
+
+	// Forgets every shape. Like g_keys.clear(), only safe once no document that uses them is alive.
+	void clear() {
+		m_shapes.clear();
+		m_keys.clear();
+		m_transitions.clear();
+		m_shapes.emplace_back();
+	}
+
+private:
+	json_shape* add(json_shape* parent, JsonKey key) {
+		auto* keys = parent->m_keys;
+		if (keys == nullptr || keys->keys.size() != parent->m_size) {
+			// A sibling already extended the parent's buffer, start a copy of the prefix
+			keys = &m_keys.emplace_back();
+			for (uint32_t i = 0; i < parent->m_size; i++) {
+				keys->append(parent->key(i));
+			}
+		}
+		keys->append(key);
+		auto& shape = m_shapes.emplace_back();
+		shape.m_id = static_cast<uint32_t>(m_shapes.size() - 1);
+		shape.m_size = parent->m_size + 1;
+		shape.m_keys = keys;
+		shape.m_first = parent->m_size == 0 ? &shape : parent->m_first;
+		shape.m_first->m_largest = (std::max)(shape.m_first->m_largest, shape.m_size);
+		return &shape;
+	}
+};
+
+// Shapes of the documents built with shaped_dict on this thread. They refer to keys in g_keys, so
+// clearing g_keys means clearing g_shapes too.
+inline thread_local json_shape_table g_shapes;
+
+// Empties g_keys and g_shapes. Call it next to g_arena.Reset(), once no document built with
+// interned_dict or shaped_dict is alive on this thread; long-running threads need it to bound both.
+inline void json_reset_keys() {
+	g_shapes.clear();
+	g_keys.clear();
+}
+
+// Key to insert into a dict of type Dict. Dicts keyed by JsonKey intern it, the others keep the text.
+template<class Dict>
+auto insert_key(JsonString key) {
+	if constexpr (std::is_same_v<typename Dict::key_type, JsonKey>) {
+		return JsonKey::intern(key);
+	}
+	else {
+		return key;
+	}
+}
+
+// An object as its shape plus one value per slot, in document order. Objects with the same keys
+// share the shape, so each one costs its values and two pointers; a key is found by its slot, which
+// callers can cache per shape to read a field of many objects in O(1) each. Adding a key may move
+// the values, as with a vector.
+template<class T, template<class> class Alloc>
+class shaped_object
+{
+	json_shape* m_shape = nullptr;	// nullptr until the first key
+	std::vector<T, Alloc<T>> m_values;
+
+	template<class Value>
+	class basic_iterator
+	{
+		const json_shape* m_shape;
+		Value* m_values;
+		size_t m_slot;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair<JsonKey, Value&>;
+		using reference = value_type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+
+		basic_iterator(const json_shape* shape, Value* values, size_t slot) : m_shape(shape), m_values(values), m_slot(slot) {}
+
+		reference operator*() const { return { m_shape->key(m_slot), m_values[m_slot] }; }
+		basic_iterator& operator++() { m_slot++; return *this; }
+		basic_iterator operator++(int) { auto it = *this; m_slot++; return it; }
+		bool operator==(const basic_iterator& other) const { return m_slot == other.m_slot && m_values == other.m_values; }
+		bool operator!=(const basic_iterator& other) const { return !(*this == other); }
+	};
+
+public:
+	using key_type = JsonKey;
+	using mapped_type = T;
+	using iterator = basic_iterator<T>;
+	using const_iterator = basic_iterator<const T>;
+
+	const json_shape* shape() const { return m_shape; }
+	size_t size() const { return m_values.size(); }
+	bool empty() const { return m_values.empty(); }
+
+	T& at(size_t slot) { return m_values[slot]; }
+	const T& at(size_t slot) const { return m_values[slot]; }
+
+	iterator begin() { return { m_shape, m_values.data(), 0 }; }
+	iterator end() { return { m_shape, m_values.data(), m_values.size() }; }
+	const_iterator begin() const { return { m_shape, m_values.data(), 0 }; }
+	const_iterator end() const { return { m_shape, m_values.data(), m_values.size() }; }
+
+	iterator find(JsonKey key) {
+		const int slot = m_shape ? m_shape->slot(key) : -1;
+		return slot < 0 ? end() : iterator{ m_shape, m_values.data(), size_t(slot) };
+	}
+
+	const_iterator find(JsonKey key) const {
+		const int slot = m_shape ? m_shape->slot(key) : -1;
+		return slot < 0 ? end() : const_iterator{ m_shape, m_values.data(), size_t(slot) };
+	}
+
+	// Appends key with value, or finds the existing one and leaves it as it is
+	std::pair<iterator, bool> emplace(JsonKey key, T value) {
+		auto* next = g_shapes.extend(m_shape ? m_shape : g_shapes.empty(), key);
+		if (next == nullptr) {
+			return { find(key), false };
+		}
+		if (m_values.empty()) {
+			m_values.reserve(next->expected_size());
+		}
+		m_values.push_back(std::move(value));
+		m_shape = next;
+		return { iterator{ m_shape, m_values.data(), m_values.size() - 1 }, true };
+	}
+
+	T& operator[](JsonKey key) {
+		auto it = find(key);
+		if (it == end()) {
+			it = emplace(key, T()).first;
+		}
+		return (*it).second;
+	}
+
+	// Interns key only when it has to be added
+	T& operator[](JsonString key) {
+		auto it = find(key);
+		if (it == end()) {
+			it = emplace(JsonKey::intern(key), T()).first;
+		}
+		return (*it).second;
+	}
+};
+
+/*
+ * Storage policies decide which containers a document is built from. A policy provides two alias
+ * templates, array<T> and dict<T>, instantiated with its own job type. Every combination below is
+ * a stock policy; jparser_policy_bench times them all on the same corpus, so a layout can be picked
+ * per workload at compile time. Arena allocators never free, so growing containers leave their old
+ * storage behind in g_arena until the next Reset(). interned_dict keys objects by JsonKey: a key
+ * repeated across thousands of objects is stored once in g_keys and compared as an integer.
+ * shaped_dict goes further and shares the whole key sequence between objects that repeat it.
+ */
+template<template<class> class Alloc>
+struct vector_array { template<class T> using type = std::vector<T, Alloc<T>>; };
+
+template<template<class> class Alloc>
+struct list_array { template<class T> using type = std::list<T, Alloc<T>>; };
+
+template<template<class> class Alloc>
+struct tree_dict { template<class T> using type = std::map<JsonString, T, std::less<JsonString>, Alloc<std::pair<const JsonString, T>>>; };
+
+template<template<class> class Alloc>
+struct hash_dict { template<class T> using type = std::unordered_map<JsonString, T, std::hash<JsonString>, std::equal_to<JsonString>, Alloc<std::pair<const JsonString, T>>>; };
+
+// Ordered by key ID, which is the order keys first appeared in the documents of the thread
+template<template<class> class Alloc>
+struct interned_dict { template<class T> using type = std::map<JsonKey, T, std::less<JsonKey>, Alloc<std::pair<const JsonKey, T>>>; };
+
+// Objects with the same key sequence share a json_shape and store only their values, see shaped_object
+template<template<class> class Alloc>
+struct shaped_dict { template<class T> using type = shaped_object<T, Alloc>; };
+
+template<class ArrayKind, class DictKind>
+struct storage_policy {
+	template<class T> using array = typename ArrayKind::template type<T>;
+	template<class T> using dict = typename DictKind::template type<T>;
+};
+
+template<class T> using HeapAllocator = std::allocator<T>;
+
+using heap_vector_tree_policy = storage_policy<vector_array<HeapAllocator>, tree_dict<HeapAllocator>>;
+using heap_vector_hash_policy = storage_policy<vector_array<HeapAllocator>, hash_dict<HeapAllocator>>;
+using heap_list_tree_policy = storage_policy<list_array<HeapAllocator>, tree_dict<HeapAllocator>>;
+using heap_list_hash_policy = storage_policy<list_array<HeapAllocator>, hash_dict<HeapAllocator>>;
+using arena_vector_tree_policy = storage_policy<vector_array<ArenaAllocator>, tree_dict<ArenaAllocator>>;
+using arena_vector_hash_policy = storage_policy<vector_array<ArenaAllocator>, hash_dict<ArenaAllocator>>;
+using arena_list_tree_policy = storage_policy<list_array<ArenaAllocator>, tree_dict<ArenaAllocator>>;
+using arena_list_hash_policy = storage_policy<list_array<ArenaAllocator>, hash_dict<ArenaAllocator>>;
+using heap_vector_interned_policy = storage_policy<vector_array<HeapAllocator>, interned_dict<HeapAllocator>>;
+using arena_vector_interned_policy = storage_policy<vector_array<ArenaAllocator>, interned_dict<ArenaAllocator>>;
+using heap_vector_shaped_policy = storage_policy<vector_array<HeapAllocator>, shaped_dict<HeapAllocator>>;
+using arena_vector_shaped_policy = storage_policy<vector_array<ArenaAllocator>, shaped_dict<ArenaAllocator>>;
+// Heap arrays, arena dicts: the layout job has always used
+using default_policy = storage_policy<vector_array<HeapAllocator>, tree_dict<ArenaAllocator>>;
+
+template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
+template<class... Ts> overloaded(Ts...)->overloaded<Ts...>;
+
+// Non-owning view of a contiguous sequence, a minimal std::span for C++17
+template<class T>
+class span
+{
+	T* m_data = nullptr;
+	size_t m_size = 0;
+
+public:
+	using element_type = T;
+	using value_type = std::remove_cv_t<T>;
+	using iterator = T*;
+
+	constexpr span() = default;
+	constexpr span(T* data, size_t size) : m_data(data), m_size(size) {}
+	template<class U, class = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+	constexpr span(const span<U>& other) : m_data(other.data()), m_size(other.size()) {}
+
+	constexpr T* data() const { return m_data; }
+	constexpr size_t size() const { return m_size; }
+	constexpr bool empty() const { return m_size == 0; }
+	constexpr T* begin() const { return m_data; }
+	constexpr T* end() const { return m_data + m_size; }
+	constexpr T& operator[](size_t i) const { return m_data[i]; }
+	constexpr T& front() const { return m_data[0]; }
+	constexpr T& back() const { return m_data[m_size - 1]; }
+	constexpr span subspan(size_t offset, size_t count) const { return { m_data + offset, count }; }
+};
+
+// An array of numbers, or of equally long arrays of numbers, stored as one flat buffer in g_arena
+// instead of a job per number. Only produced with parse_options::pack_numbers.
+struct JsonNumbers {
+	span<const double> values;
+	uint32_t tuple_size = 0;	// 0 for [x, y, ...], n for [[x1, ... xn], [y1, ... yn], ...]
+
+	// Elements of the array: numbers, or tuples of tuple_size numbers
+	size_t size() const { return tuple_size ? values.size() / tuple_size : values.size(); }
+	span<const double> tuple(size_t i) const { return values.subspan(i * tuple_size, tuple_size); }
+};
+
+inline int hex_value(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+inline char* encode_utf8(uint32_t cp, char* out) {
+	if (cp < 0x80) {
+		*out++ = static_cast<char>(cp);
+	}
+	else if (cp < 0x800) {
+		*out++ = static_cast<char>(0xC0 | (cp >> 6));
+		*out++ = static_cast<char>(0x80 | (cp & 0x3F));
+	}
+	else if (cp < 0x10000) {
+		*out++ = static_cast<char>(0xE0 | (cp >> 12));
+		*out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		*out++ = static_cast<char>(0x80 | (cp & 0x3F));
+	}
+	else {
+		*out++ = static_cast<char>(0xF0 | (cp >> 18));
+		*out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+		*out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		*out++ = static_cast<char>(0x80 | (cp & 0x3F));
+	}
+	return out;
+}
+
+// Decodes the escapes of in[0, size), the text between the quotes of a string, to out, which
+// needs room for size bytes: decoded text is never longer. On success out is advanced to the end
+// of the output. With Decode false the escapes are only checked and nothing is written. Lone
+// surrogates become U+FFFD, or are errors when strict. False with bad set to the offset of the
+// invalid escape otherwise.
+template<bool Decode>
+bool unescape_json(const char* in, size_t size, char*& out, bool strict, size_t& bad) {
+	const auto hex4 = [&](size_t at, uint32_t& unit) {
+		if (at + 4 > size) {
+			return false;
+		}
+		unit = 0;
+		for (size_t i = at; i < at + 4; i++) {
+			const auto v = hex_value(in[i]);
+			if (v < 0) {
+				return false;
+			}
+			unit = (unit << 4) | v;
+		}
+		return true;
+	};
+	const auto invalid = [&](size_t at) {
+		bad = at;
+		return false;
+	};
+	auto o = out;
+	const auto put = [&](char c) {
+		if constexpr (Decode) {
+			*o++ = c;
+		}
+	};
+	for (size_t i = 0; i < size;) {
+		const auto run = static_cast<const char*>(std::memchr(in + i, '\\', size - i));
+		const auto stop = run ? static_cast<size_t>(run - in) : size;
+		if constexpr (Decode) {
+			std::memcpy(o, in + i, stop - i);
+			o += stop - i;
+		}
+		i = stop;
+		if (i == size) {
+			break;
+		}
+		const auto escape = i;
+		switch (in[i + 1]) {
+		case '"': put('"'); break;
+		case '\\': put('\\'); break;
+		case '/': put('/'); break;
+		case 'b': put('\b'); break;
+		case 'f': put('\f'); break;
+		case 'n': put('\n'); break;
+		case 'r': put('\r'); break;
+		case 't': put('\t'); break;
+		case 'u':
+		{
+			uint32_t cp;
+			if (!hex4(i + 2, cp)) {
+				return invalid(escape);
+			}
+			i += 4;
+			if (cp >= 0xD800 && cp <= 0xDBFF) {
+				// High surrogate, a low one must follow to form a supplementary code point
+				uint32_t low;
+				if (i + 8 <= size && in[i + 2] == '\\' && in[i + 3] == 'u' && hex4(i + 4, low) && low >= 0xDC00 && low <= 0xDFFF) {
+					cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+					i += 6;
+				}
+				else if (strict) {
+					return invalid(escape);
+				}
+				else {
+					cp = 0xFFFD;
+				}
+			}
+			else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+				if (strict) {
+					return invalid(escape);
+				}
+				cp = 0xFFFD;
+			}
+			if constexpr (Decode) {
+				o = encode_utf8(cp, o);
+			}
+			break;
+		}
+		default:
+			return invalid(escape);
+		}
+		i += 2;
+	}
+	out = o;
+	return true;
+}
+
+// A string with escapes, kept as written; only produced with parse_options::lazy_strings, where
+// strings without escapes stay plain JsonString views. The escapes have been checked. value()
+// decodes into g_arena the first time and caches the view; decode() decodes on every call and
+// writes nothing in the string, for documents shared between threads. Decoded text lives in the
+// arena of the calling thread.
+struct JsonRawString {
+	const char* text;	// between the quotes
+	uint32_t size;
+	mutable uint32_t decoded_size = 0;
+	mutable const char* decoded = nullptr;
+
+	JsonString raw() const { return { text, size }; }
+
+	JsonString decode() const {
+		const auto out = static_cast<char*>(g_arena.Alloc(size));
+		auto end = out;
+		size_t bad;
+		unescape_json<true>(text, size, end, false, bad);
+		return { out, static_cast<size_t>(end - out) };
+	}
+
+	JsonString value() const {
+		if (decoded == nullptr) {
+			const auto view = decode();
+			decoded = view.data();
+			decoded_size = static_cast<uint32_t>(view.size());
+		}
+		return { decoded, decoded_size };
+	}
+};
+
+// Converts the number at p, which must be followed by a character that cannot continue it, as in
+// the text of a document. Returns the end of the number, p if there is none.
+// Short decimals take Clinger's fast path: at most 19 digits that fit in 53 bits, scaled by an
+// exact power of ten up to 10^22, round correctly with one multiplication or division.
+// Everything else, and anything strtod reads differently, goes to strtod.
+inline const char* read_number(const char* p, double& number) {
+	static constexpr double Pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	const char* q = p;
+	const bool negative = *q == '-';
+	q += negative;
+	uint64_t mantissa = 0;
+	int digits = 0, exponent = 0;
+	const auto digit = [](char c) { return static_cast<unsigned>(c - '0') < 10; };
+	for (; digit(*q); q++, digits++) {
+		mantissa = mantissa * 10 + (*q - '0');
+	}
+	bool fast = digits > 0;
+	if (*q == '.') {
+		const auto fraction = ++q;
+		for (; digit(*q); q++, digits++) {
+			mantissa = mantissa * 10 + (*q - '0');
+		}
+		exponent = -static_cast<int>(q - fraction);
+		fast = fast && q > fraction;
+	}
+	if (*q == 'e' || *q == 'E') {
+		q++;
+		const bool negativeExponent = *q == '-';
+		q += *q == '-' || *q == '+';
+		int e = 0;
+		const auto first = q;
+		for (; digit(*q) && e < 10000; q++) {
+			e = e * 10 + (*q - '0');
+		}
+		fast = fast && q > first;
+		exponent += negativeExponent ? -e : e;
+	}
+	fast = fast && digits <= 19 && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22 &&
+		!std::isalnum(static_cast<unsigned char>(*q)) && *q != '.';
+	if (fast) {
+		const double value = exponent < 0 ? mantissa / Pow10[-exponent] : mantissa * Pow10[exponent];
+		number = negative ? -value : value;
+		return q;
+	}
+	char* end;
+	number = std::strtod(p, &end);
+	return end;
+}
+
+// A number kept as its text in the parsed document, only produced with parse_options::lazy_numbers.
+// The text follows the JSON grammar. value() converts it once and caches the result; to_double()
+// converts on every call but writes nothing, so it is the one to use on a document shared by threads.
+struct JsonRawNumber {
+	const char* text;
+	uint32_t size;
+	mutable bool cached = false;
+	mutable double number = 0;
+
+	JsonString view() const { return { text, size }; }
+
+	double to_double() const {
+		double n;
+		read_number(text, n);
+		return n;
+	}
+
+	double value() const {
+		if (!cached) {
+			number = to_double();
+			cached = true;
+		}
+		return number;
+	}
+
+	// Without fraction or exponent
+	bool is_integer() const {
+		return std::none_of(text, text + size, [](char c) { return c == '.' || c == 'e' || c == 'E'; });
+	}
+
+	// Exact for integers in range; anything else is converted through double, clamped to the range
+	int64_t to_int64() const {
+		const bool negative = text[0] == '-';
+		if (is_integer() && size - negative <= 19) {
+			uint64_t magnitude = 0;
+			for (uint32_t i = negative; i < size; i++) {
+				magnitude = magnitude * 10 + (text[i] - '0');
+			}
+			if (magnitude <= uint64_t((std::numeric_limits<int64_t>::max)()) + negative) {
+				return negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+			}
+		}
+		const double n = value();
+		if (n >= 9223372036854775807.0) {
+			return (std::numeric_limits<int64_t>::max)();
+		}
+		return n <= -9223372036854775808.0 ? (std::numeric_limits<int64_t>::min)() : static_cast<int64_t>(n);
+	}
+};
+
+template<class Policy>
+struct basic_job {
+	using policy_type = Policy;
+	using array_type = typename Policy::template array<basic_job>;
+	using dict_type = typename Policy::template dict<basic_job>;
+
+	std::variant<JsonNumber, JsonBoolean, JsonString, dict_type, array_type, JsonNull, JsonNumbers, JsonRawNumber, JsonRawString> value;
+	basic_job() : value(JsonNull()) {}
+	basic_job(JsonNumber n) : value(n) {}
+	basic_job(JsonBoolean v) : value(v) {}
+	basic_job(JsonString text) : value(text) {}
+	basic_job(dict_type dict) : value(std::move(dict)) {}
+	basic_job(array_type array) : value(std::move(array)) {}
+	basic_job(JsonNumbers numbers) : value(numbers) {}
+	basic_job(JsonRawNumber number) : value(number) {}
+	basic_job(JsonRawString text) : value(text) {}
+
+	basic_job(basic_job&&)noexcept = default;
+
+	// The old value is torn down like in the destructor; other may be a part of it
+	basic_job& operator=(basic_job&& other) noexcept {
+		if (this != &other) {
+			basic_job old(std::move(*this));
+			value = std::move(other.value);
+		}
+		return *this;
+	}
+
+	// The top levels of a tree are destroyed recursively. Below them, nested containers are moved
+	// onto a work list and torn down from there, so a deep tree does not recurse once per level.
+	~basic_job() {
+		static constexpr size_t RecursiveLevels = 64;
+		static thread_local size_t depth = 0;
+		if (depth < RecursiveLevels) {
+			depth++;
+			value.template emplace<JsonNull>();
+			depth--;
+			return;
+		}
+		std::vector<basic_job> pending;
+		detach_nested(pending);
+		while (!pending.empty()) {
+			auto last = std::move(pending.back());
+			pending.pop_back();
+			last.detach_nested(pending);
+		}
+	}
+
+	// Adds a null value under key if the dict does not have it
+	basic_job& operator[](const JsonString& key) {
+		if (auto* dict = std::get_if<dict_type>(&value)) {
+			if (auto it = dict->find(key); it != dict->end()) {
+				return (*it).second;
+			}
+			return (*dict)[insert_key<dict_type>(key)];
+		}
+		JPARSER_THROW(std::runtime_error("value is not a dict"));
+	}
+
+	// as<JsonNumber>() also converts a JsonRawNumber, as<JsonString>() decodes a JsonRawString
+	template<typename T>
+	T as() const {
+		if (auto* ptr = std::get_if<T>(&value)) {
+			return*ptr;
+		}
+		if constexpr (std::is_same_v<T, JsonNumber>) {
+			if (auto* raw = std::get_if<JsonRawNumber>(&value)) {
+				return raw->value();
+			}
+		}
+		if constexpr (std::is_same_v<T, JsonString>) {
+			if (auto* raw = std::get_if<JsonRawString>(&value)) {
+				return raw->value();
+			}
+		}
+		JPARSER_THROW(std::runtime_error("value is invalid"));
+	}
+
+	void pretty_print(std::ostream& os)const;
+
+private:
+	// Moves every child that is a non-empty container to pending, leaving empty ones behind
+	void detach_nested(std::vector<basic_job>& pending) {
+		const auto detach = [&](basic_job& child) {
+			const auto* dict = std::get_if<dict_type>(&child.value);
+			const auto* array = std::get_if<array_type>(&child.value);
+			if ((dict && !dict->empty()) || (array && !array->empty())) {
+				pending.push_back(std::move(child));
+			}
+		};
+		if (auto* dict = std::get_if<dict_type>(&value)) {
+			for (auto&& member : *dict) {
+				detach(member.second);
+			}
+		}
+		else if (auto* array = std::get_if<array_type>(&value)) {
+			for (auto& element : *array) {
+				detach(element);
+			}
+		}
+	}
+};
+
+using job = basic_job<default_policy>;
+using JsonArray = job::array_type;
+using JsonDict = job::dict_type;
+
+struct write_options {
+	int indent = 0;			// indent_char repeats per nesting level, 0 writes compact output
+	char indent_char = ' ';
+};
+
+// Receives streamed output in order, a batch of filled buffers per call. Returns false to stop writing.
+using json_sink = std::function<bool(const std::string_view* chunks, size_t count)>;
+
+// Sink that writes to a file descriptor, gathering each batch into as few system calls as possible
+inline json_sink fd_sink(int fd) {
+	return [fd](const std::string_view* chunks, size_t count) {
+#if defined(_WIN32)
+		for (size_t i = 0; i < count; i++) {
+			for (size_t done = 0; done < chunks[i].size();) {
+				const auto n = _write(fd, chunks[i].data() + done, static_cast<unsigned>((std::min)(chunks[i].size() - done, size_t(1) << 30)));
+				if (n <= 0) {
+					return false;
+				}
+				done += n;
+			}
+		}
+#else
+		constexpr size_t MaxBatch = 16;
+		iovec iov[MaxBatch];
+		while (count > 0) {
+			const auto batch = (std::min)(count, MaxBatch);
+			for (size_t i = 0; i < batch; i++) {
+				iov[i].iov_base = const_cast<char*>(chunks[i].data());
+				iov[i].iov_len = chunks[i].size();
+			}
+			// writev may stop short, resume from the first iovec that is not fully written
+			for (auto first = iov, last = iov + batch; first != last;) {
+				const auto n = ::writev(fd, first, static_cast<int>(last - first));
+				if (n < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					return false;
+				}
+				auto left = static_cast<size_t>(n);
+				for (; first != last && left >= first->iov_len; ++first) {
+					left -= first->iov_len;
+				}
+				if (first != last) {
+					first->iov_base = static_cast<char*>(first->iov_base) + left;
+					first->iov_len -= left;
+				}
+			}
+			chunks += batch;
+			count -= batch;
+		}
+#endif
+		return true;
+	};
+}
+
+// Serializes JSON either into one contiguous buffer or, with a sink attached, through a fixed ring
+// of buffers. The contiguous buffer is kept between calls, so a long-lived writer stops allocating
+// once it has seen its largest document. A streaming writer hands the ring to the sink whenever
+// every buffer is full, so its memory is bounded by buffer_size * buffer_count.
+// Besides whole job trees it accepts a document as a sequence of events (begin_dict, key, value...).
+class json_writer
+{
+	char* m_data = nullptr;
+	size_t m_size = 0;
+	size_t m_capacity = 0;
+	write_options m_options;
+
+	json_sink m_sink;
+	std::unique_ptr<char[]> m_ring;
+	std::vector<std::string_view> m_filled;
+	size_t m_bufferCount = 0;
+	size_t m_flushed = 0;
+	bool m_failed = false;
+
+	int m_depth = 0;
+	bool m_needComma = false;
+	bool m_afterKey = false;
+
+public:
+	explicit json_writer(write_options options = {}) : m_options(options) {}
+
+	json_writer(json_sink sink, write_options options = {}, size_t buffer_size = 64 * 1024, size_t buffer_count = 4) :
+		m_capacity((std::max)(buffer_size, size_t(16 * 1024))),
+		m_options(options),
+		m_sink(std::move(sink)),
+		m_bufferCount((std::max)(buffer_count, size_t(1)))
+	{
+		m_ring.reset(new char[m_capacity * m_bufferCount]);
+		m_filled.reserve(m_bufferCount);
+		m_data = m_ring.get();
+	}
+
+	json_writer(const json_writer&) = delete;
+	json_writer& operator=(const json_writer&) = delete;
+
+	~json_writer() {
+		if (m_sink) {
+			flush();
+		}
+		else {
+			std::free(m_data);
+		}
+	}
+
+	// The view stays valid until the next write. A streaming writer flushes instead and returns an empty view.
+	template<class Policy>
+	std::string_view write(const basic_job<Policy>& value) {
+		clear();
+		write_value(value);
+		if (m_sink) {
+			flush();
+			return {};
+		}
+		return view();
+	}
+
+	std::string_view view() const {
+		return { m_data, m_size };
+	}
+
+	void clear() {
+		m_size = 0;
+		m_flushed = 0;
+		m_depth = 0;
+		m_needComma = false;
+		m_afterKey = false;
+	}
+
+	// Hands everything written so far to the sink. False once the sink has refused output.
+	bool flush() {
+		if (!m_sink) {
+			return true;
+		}
+		if (m_size > 0) {
+			m_filled.emplace_back(m_data, m_size);
+			m_flushed += m_size;
+		}
+		if (!m_failed && !m_filled.empty() && !m_sink(m_filled.data(), m_filled.size())) {
+			m_failed = true;
+		}
+		m_filled.clear();
+		m_data = m_ring.get();
+		m_size = 0;
+		return !m_failed;
+	}
+
+	bool good() const {
+		return !m_failed;
+	}
+
+	// Bytes produced since clear(), including those already handed to the sink
+	size_t written() const {
+		return m_flushed + m_size;
+	}
+
+	// A streaming writer can only promise room within one ring buffer, larger requests throw
+	void reserve(size_t bytes) {
+		if (m_size + bytes > m_capacity) {
+			grow(m_size + bytes);
+		}
+	}
+
+	void begin_dict() {
+		separate();
+		put('{');
+		m_depth++;
+		m_needComma = false;
+	}
+
+	void end_dict() {
+		close('}');
+	}
+
+	void begin_array() {
+		separate();
+		put('[');
+		m_depth++;
+		m_needComma = false;
+	}
+
+	void end_array() {
+		close(']');
+	}
+
+	void key(JsonString name) {
+		separate();
+		write_string(name);
+		m_options.indent ? put(": ") : put(':');
+		m_afterKey = true;
+	}
+
+	void value(JsonNumber number) {
+		separate();
+		write_number(number);
+		m_needComma = true;
+	}
+
+	void value(JsonBoolean boolean) {
+		separate();
+		boolean ? put("true") : put("false");
+		m_needComma = true;
+	}
+
+	void value(JsonString text) {
+		separate();
+		write_string(text);
+		m_needComma = true;
+	}
+
+	void value(const char* text) {
+		value(JsonString(text));
+	}
+
+	void value(JsonNull) {
+		separate();
+		put("null");
+		m_needComma = true;
+	}
+
+	// Written as it was read
+	void value(const JsonRawNumber& number) {
+		separate();
+		put(number.text, number.size);
+		m_needComma = true;
+	}
+
+	// Written as it was read, its escapes are valid JSON
+	void value(const JsonRawString& text) {
+		separate();
+		put('"');
+		put(text.text, text.size);
+		put('"');
+		m_needComma = true;
+	}
+
+	// Integers are written exactly, 64-bit values included
+	template<class I, std::enable_if_t<std::is_integral_v<I> && !std::is_same_v<I, bool>, int> = 0>
+	void value(I integer) {
+		separate();
+		reserve(24);
+		m_size = std::to_chars(m_data + m_size, m_data + m_size + 24, integer).ptr - m_data;
+		m_needComma = true;
+	}
+
+	// A key already in its JSON spelling, quotes included, such as the compile-time keys of json_bind.h
+	void escaped_key(JsonString quoted) {
+		separate();
+		put(quoted.data(), quoted.size());
+		m_options.indent ? put(": ") : put(':');
+		m_afterKey = true;
+	}
+
+	// Open containers are kept on an explicit stack of iterators, so deep trees do not recurse
+	template<class Policy>
+	void write_value(const basic_job<Policy>& root) {
+		using job_type = basic_job<Policy>;
+		using array_type = typename job_type::array_type;
+		using dict_type = typename job_type::dict_type;
+		using array_range = std::pair<typename array_type::const_iterator, typename array_type::const_iterator>;
+		using dict_range = std::pair<typename dict_type::const_iterator, typename dict_type::const_iterator>;
+		std::vector<std::variant<array_range, dict_range>> open;
+		const job_type* next = &root;
+		while (next) {
+			if (const auto* array = std::get_if<array_type>(&next->value)) {
+				begin_array();
+				open.emplace_back(array_range{ array->begin(), array->end() });
+			}
+			else if (const auto* dict = std::get_if<dict_type>(&next->value)) {
+				begin_dict();
+				open.emplace_back(dict_range{ dict->begin(), dict->end() });
+			}
+			else {
+				write_scalar(*next);
+			}
+			// Close every container that is done, the next value is the first one left in an open container
+			next = nullptr;
+			while (!next && !open.empty()) {
+				if (auto* elements = std::get_if<array_range>(&open.back())) {
+					if (elements->first != elements->second) {
+						next = &*elements->first++;
+						continue;
+					}
+					end_array();
+				}
+				else {
+					auto& members = std::get<dict_range>(open.back());
+					if (members.first != members.second) {
+						auto&& member = *members.first++;
+						key(member.first);
+						next = &member.second;
+						continue;
+					}
+					end_dict();
+				}
+				open.pop_back();
+			}
+		}
+	}
+
+	// Any value but an array or a dict
+	template<class Policy>
+	void write_scalar(const basic_job<Policy>& v) {
+		std::visit(overloaded{
+			[&](JsonNumber number) { value(number); },
+			[&](JsonBoolean boolean) { value(boolean); },
+			[&](JsonString text) { value(text); },
+			[&](JsonNull null) { value(null); },
+			[&](const typename basic_job<Policy>::array_type&) {},
+			[&](const typename basic_job<Policy>::dict_type&) {},
+			[&](const JsonNumbers& numbers) {
+				begin_array();
+				for (size_t i = 0; i < numbers.size(); i++) {
+					if (numbers.tuple_size == 0) {
+						value(numbers.values[i]);
+						continue;
+					}
+					begin_array();
+					for (const auto n : numbers.tuple(i)) {
+						value(n);
+					}
+					end_array();
+				}
+				end_array();
+			},
+			[&](const JsonRawNumber& number) { value(number); },
+			[&](const JsonRawString& text) { value(text); },
+			}, v.value);
+	}
+
+	static constexpr bool needs_escape(char c) {
+		return c == '"' || c == '\\' || static_cast<uint8_t>(c) < 0x20;
+	}
+
+	// Writes the escape sequence of a character that needs_escape, returns the end of it
+	static constexpr char* write_escape(char c, char* out) {
+		constexpr const char* Hex = "0123456789abcdef";
+		*out++ = '\\';
+		switch (c) {
+		case '"': *out++ = '"'; break;
+		case '\\': *out++ = '\\'; break;
+		case '\b': *out++ = 'b'; break;
+		case '\f': *out++ = 'f'; break;
+		case '\n': *out++ = 'n'; break;
+		case '\r': *out++ = 'r'; break;
+		case '\t': *out++ = 't'; break;
+		default:
+			*out++ = 'u';
+			*out++ = '0';
+			*out++ = '0';
+			*out++ = Hex[(c >> 4) & 0xF];
+			*out++ = Hex[c & 0xF];
+		}
+		return out;
+	}
+
+private:
+	void grow(size_t required) {
+		if (m_sink) {
+			const auto bytes = required - m_size;
+			rotate();
+			if (bytes > m_capacity) {
+				JPARSER_THROW(std::length_error("json_writer: write larger than one sink buffer"));
+			}
+			return;
+		}
+		const auto capacity = (std::max)({ required, m_capacity * 2, size_t(4096) });
+		const auto data = static_cast<char*>(std::realloc(m_data, capacity));
+		if (data == nullptr) {
+			JPARSER_THROW(std::bad_alloc());
+		}
+		m_data = data;
+		m_capacity = capacity;
+	}
+
+	// Retires the current ring buffer and moves to the next one, flushing when the ring is used up
+	void rotate() {
+		m_filled.emplace_back(m_data, m_size);
+		m_flushed += m_size;
+		m_size = 0;
+		if (m_filled.size() == m_bufferCount) {
+			flush();
+			return;
+		}
+		m_data = m_ring.get() + m_filled.size() * m_capacity;
+	}
+
+	void separate() {
+		if (m_afterKey) {
+			m_afterKey = false;
+			return;
+		}
+		if (m_needComma) {
+			put(',');
+		}
+		if (m_depth > 0) {
+			newline(m_depth);
+		}
+	}
+
+	void close(char bracket) {
+		m_depth--;
+		if (m_needComma) {
+			newline(m_depth);
+		}
+		put(bracket);
+		m_needComma = true;
+	}
+
+	void put(char c) {
+		reserve(1);
+		m_data[m_size++] = c;
+	}
+
+	// A streaming writer gets the bytes in pieces of at most one ring buffer
+	void put(const char* s, size_t n) {
+		while (n > 0) {
+			const auto piece = m_sink ? (std::min)(n, m_capacity) : n;
+			reserve(piece);
+			std::memcpy(m_data + m_size, s, piece);
+			m_size += piece;
+			s += piece;
+			n -= piece;
+		}
+	}
+
+	template<size_t N>
+	void put(const char(&s)[N]) {
+		put(s, N - 1);
+	}
+
+	void newline(int depth) {
+		if (m_options.indent == 0) {
+			return;
+		}
+		put('\n');
+		// Deep indentation can exceed a ring buffer, so it is filled in pieces like put()
+		for (auto n = static_cast<size_t>(depth) * m_options.indent; n > 0;) {
+			const auto piece = m_sink ? (std::min)(n, m_capacity) : n;
+			reserve(piece);
+			std::memset(m_data + m_size, m_options.indent_char, piece);
+			m_size += piece;
+			n -= piece;
+		}
+	}
+
+#if defined(JPARSER_AVX2)
+	static constexpr size_t EscapeWidth = 32;
+
+	// Stores one vector of text to out and returns the bitmask of bytes that need escaping
+	static uint32_t copy_escape_mask(const char* in, char* out) {
+		const auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chunk);
+		const auto special = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))),
+			_mm256_cmpeq_epi8(_mm256_min_epu8(chunk, _mm256_set1_epi8(0x1F)), chunk));
+		return _mm256_movemask_epi8(special);
+	}
+#elif defined(JPARSER_SSE2)
+	static constexpr size_t EscapeWidth = 16;
+
+	static uint32_t copy_escape_mask(const char* in, char* out) {
+		const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), chunk);
+		const auto special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))),
+			_mm_cmpeq_epi8(_mm_min_epu8(chunk, _mm_set1_epi8(0x1F)), chunk));
+		return _mm_movemask_epi8(special);
+	}
+#endif
+
+	void write_string(JsonString text) {
+		put('"');
+		// A streaming writer only guarantees contiguous room within one ring buffer
+		const size_t piece = m_sink ? m_capacity / 4 : text.size();
+		for (size_t i = 0; i < text.size(); i += piece) {
+			write_escaped(text.substr(i, piece));
+		}
+		put('"');
+	}
+
+	// Clean runs are stored a whole vector at a time while they are being checked, so only
+	// bytes that need escaping take the branchy path. The buffer always keeps room for the
+	// unwritten rest of the text plus one vector of slack for those stores.
+	void write_escaped(JsonString text) {
+		constexpr size_t Slack = 32;
+		auto p = text.data();
+		const auto end = p + text.size();
+		reserve(text.size() + 1 + Slack);
+		auto out = m_data + m_size;
+		while (p < end) {
+#if defined(JPARSER_AVX2) || defined(JPARSER_SSE2)
+			size_t n = end - p;
+			uint32_t mask;
+			if (n >= EscapeWidth) {
+				n = EscapeWidth;
+				mask = copy_escape_mask(p, out);
+			}
+			else {
+				// Short tail goes through a stack copy so the load never crosses the end of the text
+				char tail[EscapeWidth];
+				std::memcpy(tail, p, n);
+				mask = copy_escape_mask(tail, out) & ((1u << n) - 1);
+			}
+			if (mask == 0) {
+				p += n;
+				out += n;
+				continue;
+			}
+			n = trailing_zeros(mask);
+			p += n;
+			out += n;
+#else
+			if (!needs_escape(*p)) {
+				*out++ = *p++;
+				continue;
+			}
+#endif
+			m_size = out - m_data;
+			reserve(6 + (end - p) + 1 + Slack);
+			out = write_escape(*p++, m_data + m_size);
+		}
+		m_size = out - m_data;
+	}
+
+	// Shortest text that parses back to the same double, with integers taking the exact int64 path
+	void write_number(JsonNumber number) {
+		constexpr double MaxExactInteger = 9007199254740992.0;	// 2^53
+		reserve(32);
+		const auto first = m_data + m_size;
+		std::to_chars_result result;
+		if (number > -MaxExactInteger && number < MaxExactInteger && number == static_cast<double>(static_cast<int64_t>(number)) &&
+			!(number == 0 && std::signbit(number))) {
+			result = std::to_chars(first, first + 32, static_cast<int64_t>(number));
+		}
+		else if (std::isfinite(number)) {
+			result = std::to_chars(first, first + 32, number);
+		}
+		else {
+			put("null");	// JSON has no spelling for inf and nan
+			return;
+		}
+		m_size = result.ptr - m_data;
+	}
+};
+
+template<class Policy>
+void basic_job<Policy>::pretty_print(std::ostream& os) const {
+	json_writer writer({ 1, '\t' });
+	os << writer.write(*this) << std::endl;
+}
+
+enum class error_kind {
+	none,
+	unexpected_character,	// a structural character ({ } [ ] : , ") is missing
+	invalid_value,			// no value starts at this position
+	invalid_literal,		// misspelled null, true or false
+	invalid_number,
+	unterminated_string,
+	invalid_utf8,
+	invalid_escape,
+	duplicate_key,
+	depth_exceeded,
+	invalid_schema,			// well-formed JSON that a typed decoder cannot map onto its types
+	trailing_characters,	// something other than whitespace follows the document
+};
+
+inline const char* describe(error_kind kind) {
+	switch (kind) {
+	case error_kind::none: return "no error";
+	case error_kind::unexpected_character: return "unexpected character";
+	case error_kind::invalid_value: return "invalid value";
+	case error_kind::invalid_literal: return "invalid literal";
+	case error_kind::invalid_number: return "invalid number";
+	case error_kind::unterminated_string: return "unterminated string";
+	case error_kind::invalid_utf8: return "invalid utf-8 in string";
+	case error_kind::invalid_escape: return "invalid escape sequence";
+	case error_kind::duplicate_key: return "duplicate key";
+	case error_kind::depth_exceeded: return "maximum depth exceeded";
+	case error_kind::invalid_schema: return "value does not match the schema";
+	case error_kind::trailing_characters: return "trailing characters after the document";
+	}
+	return "unknown error";
+}
+
+// Where and why parsing stopped. Line and column are 1-based and count bytes.
+struct json_error {
+	error_kind kind = error_kind::none;
+	size_t offset = 0;
+	size_t line = 0;
+	size_t column = 0;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const json_error& e) {
+	return os << describe(e.kind) << " at line " << e.line << ", column " << e.column << " (offset " << e.offset << ")";
+}
+
+#if !defined(JPARSER_NO_EXCEPTIONS)
+struct parse_error : std::runtime_error {
+	json_error error;
+	explicit parse_error(const json_error& e) : std::runtime_error(to_string(e)), error(e) {}
+
+	static std::string to_string(const json_error& e) {
+		std::ostringstream ss;
+		ss << e;
+		return ss.str();
+	}
+};
+#endif
+
+template<typename E>
+struct unexpected {
+	E error;
+};
+
+template<typename E>
+unexpected<std::decay_t<E>> make_unexpected(E&& e) {
+	return { std::forward<E>(e) };
+}
+
+// Either a value or the error that prevented producing it, a minimal std::expected for C++17
+template<typename T, typename E>
+class expected {
+	std::variant<T, E> m_storage;
+
+public:
+	expected(T value) : m_storage(std::in_place_index<0>, std::move(value)) {}
+	expected(unexpected<E> e) : m_storage(std::in_place_index<1>, std::move(e.error)) {}
+
+	bool has_value() const noexcept { return m_storage.index() == 0; }
+	explicit operator bool() const noexcept { return has_value(); }
+
+	T& operator*() & { return *std::get_if<0>(&m_storage); }
+	T&& operator*() && { return std::move(*std::get_if<0>(&m_storage)); }
+	T* operator->() { return std::get_if<0>(&m_storage); }
+	const E& error() const { return *std::get_if<1>(&m_storage); }
+
+	T& value() & {
+		if (!has_value()) {
+			JPARSER_THROW(std::runtime_error("expected has no value"));
+		}
+		return **this;
+	}
+	T&& value() && { return std::move(value()); }
+};
+
+struct parse_options {
+	// Ceiling on max_depth. Trees are built, written and destroyed without recursing per level, but
+	// typed decoders and callers' own walks of a tree do recurse, so deeper input is never accepted.
+	static constexpr size_t MaxDepth = 1024;
+
+	bool validate_utf8 = false;	// reject strings that are not well-formed UTF-8
+	size_t max_depth = MaxDepth;	// deepest container nesting accepted, empty containers included; clamped to MaxDepth
+	bool pack_numbers = false;	// store arrays of numbers and of numeric tuples as JsonNumbers
+	bool lazy_numbers = false;	// store other numbers as JsonRawNumber text, converted when read
+	bool lazy_strings = false;	// store string values with escapes as JsonRawString, decoded when read; keys are always decoded
+};
+
+// A container that is still being filled while the parser descends into one of its values
+template<class Job>
+struct parse_frame {
+	Job container;
+	JsonString key;		// key the pending value is stored under, dicts only
+	size_t key_pos;		// offset of the key's text in the document, decoded keys live elsewhere
+	bool is_dict;
+};
+
+// Lexical layer shared by the DOM parser and schema-specific decoders. Besides the token readers it
+// offers a small pull API (parse_members, parse_elements, skip_value) for code that maps a known
+// document layout straight onto its own types without building a tree first.
+// Errors never unwind: every step returns false after recording what failed and where,
+// so malformed input is rejected as cheaply as valid input is accepted.
+struct json_scanner {
+	size_t pos;
+	std::string j;
+	parse_options options;
+	error_kind failure = error_kind::none;
+	size_t failure_pos = 0;
+	json_scanner() :pos(0) {}
+	json_scanner(std::string json, parse_options opts = {}) :pos(0), j(json), options(opts) {}
+
+	// Where and why the last failed step stopped
+	json_error error() const {
+		return locate(failure, failure_pos);
+	}
+
+	void rewind() {
+		pos = 0;
+		failure = error_kind::none;
+		m_depth = 0;
+	}
+
+	bool fail(error_kind kind) {
+		return fail_at(pos, kind);
+	}
+
+	bool fail_at(size_t at, error_kind kind) {
+		failure = kind;
+		failure_pos = at;
+		return false;
+	}
+
+	bool expect(char e) {
+		parse_whitespace();
+		if (j[pos] == e) {
+			pos++;
+			return true;
+		}
+		return fail(error_kind::unexpected_character);
+	}
+
+	char peek() {
+		parse_whitespace();
+		return j[pos];
+	}
+
+	// Runs read one container deeper. Called with pos at the bracket, which is reported if the
+	// container is one level too many.
+	template<class Fn>
+	bool nested(Fn&& read) {
+		if (m_depth >= depth_limit()) {
+			return fail(error_kind::depth_exceeded);
+		}
+		m_depth++;
+		const bool ok = read();
+		m_depth--;
+		return ok;
+	}
+
+	// Nesting limit of this parse, options.max_depth clamped to parse_options::MaxDepth
+	size_t depth_limit() const {
+		return (std::min)(options.max_depth, parse_options::MaxDepth);
+	}
+
+	// Only whitespace may follow the document
+	bool expect_end() {
+		parse_whitespace();
+		return pos == j.size() || fail(error_kind::trailing_characters);
+	}
+
+	bool parse_key(JsonString& key) {
+		return parse_string(key) && expect(':');
+	}
+
+	bool parse_string(JsonString& text) {
+		bool escaped;
+		if (!scan_string(text, escaped)) {
+			return false;
+		}
+		if (escaped) {
+			const auto begin = static_cast<size_t>(text.data() - j.data());
+			return unescape(begin, begin + text.size(), text);
+		}
+		return true;
+	}
+
+	// A string as written, for lazy decoding: escaped tells whether it has escapes, which are
+	// checked but not decoded
+	bool parse_raw_string(JsonString& text, bool& escaped) {
+		if (!scan_string(text, escaped)) {
+			return false;
+		}
+		char* out = nullptr;
+		size_t bad;
+		if (escaped && !unescape_json<false>(text.data(), text.size(), out, options.validate_utf8, bad)) {
+			return fail_at(text.data() - j.data() + bad, error_kind::invalid_escape);
+		}
+		return true;
+	}
+
+	// Finds the end of a string and validates its UTF-8, text is what lies between the quotes
+	bool scan_string(JsonString& text, bool& escaped) {
+		if (!expect('"')) {
+			return false;
+		}
+		const auto begin = pos;
+		const auto size = j.size();
+		uint32_t nonAscii = 0;	// high bits seen so far, decides whether the string needs validating
+		escaped = false;
+		for (;;) {
+#if defined(JPARSER_SSE2)
+			// Skip 16-byte runs that have neither a quote nor a backslash
+			const auto quote = _mm_set1_epi8('"');
+			const auto backslash = _mm_set1_epi8('\\');
+			while (pos + 16 <= size) {
+				const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&j[pos]));
+				const uint32_t stop = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+				const uint32_t high = _mm_movemask_epi8(chunk);
+				if (stop) {
+					const auto n = trailing_zeros(stop);
+					nonAscii |= high & ((1u << n) - 1);
+					pos += n;
+					break;
+				}
+				nonAscii |= high;
+				pos += 16;
+			}
+#endif
+			if (pos >= size) {
+				return fail(error_kind::unterminated_string);
+			}
+			const char c = j[pos];
+			if (c == '"') {
+				break;
+			}
+			if (c == '\\') {
+				// escape char
+				if (pos + 1 >= size) {
+					return fail(error_kind::unterminated_string);
+				}
+				escaped = true;
+				pos += 2;
+			}
+			else {
+				nonAscii |= static_cast<uint8_t>(c) & 0x80;
+				pos++;
+			}
+		}
+		if (options.validate_utf8 && nonAscii && !utf8_validate(&j[begin], pos - begin)) {
+			pos = begin;
+			return fail(error_kind::invalid_utf8);
+		}
+		text = JsonString(&j[begin], pos - begin);
+		pos++;	// closing quote
+		return true;
+	}
+
+	bool parse_number(double& number) {
+		const auto p = peek_ptr();
+		const auto end = read_number(p, number);
+		if (end == p) {
+			return fail(error_kind::invalid_number);
+		}
+		pos += end - p;
+		return true;
+	}
+
+	// Reads a number that follows the JSON grammar exactly, as text. Anything else returns false
+	// with pos unchanged and no error set, for parse_number to read or reject.
+	bool parse_raw_number(JsonString& text) {
+		const auto digit = [](char c) { return static_cast<unsigned>(c - '0') < 10; };
+		const char* p = peek_ptr();
+		const char* q = p + (*p == '-');
+		if (*q == '0') {
+			q++;
+		}
+		else if (!digit(*q)) {
+			return false;
+		}
+		else {
+			while (digit(*q)) {
+				q++;
+			}
+		}
+		if (*q == '.') {
+			if (!digit(*++q)) {
+				return false;
+			}
+			while (digit(*q)) {
+				q++;
+			}
+		}
+		if (*q == 'e' || *q == 'E') {
+			q++;
+			q += *q == '-' || *q == '+';
+			if (!digit(*q)) {
+				return false;
+			}
+			while (digit(*q)) {
+				q++;
+			}
+		}
+		// Where strtod would read on, so does parse_number
+		if (std::isalnum(static_cast<unsigned char>(*q)) || *q == '.') {
+			return false;
+		}
+		text = JsonString(p, q - p);
+		pos += q - p;
+		return true;
+	}
+
+	// Reads a dict, calling fn(key) with the scanner positioned on each value. fn must consume
+	// the value (or skip_value() it) and return false to abort.
+	template<typename Fn>
+	bool parse_members(Fn&& fn) {
+		if (!expect('{')) {
+			return false;
+		}
+		if (peek() == '}') {
+			pos++;
+			return true;
+		}
+		for (;;) {
+			JsonString key;
+			if (!parse_key(key) || !fn(key)) {
+				return false;
+			}
+			if (peek() == ',') {
+				pos++;
+				continue;
+			}
+			return expect('}');
+		}
+	}
+
+	// Reads an array, calling fn() with the scanner positioned on each element
+	template<typename Fn>
+	bool parse_elements(Fn&& fn) {
+		if (!expect('[')) {
+			return false;
+		}
+		if (peek() == ']') {
+			pos++;
+			return true;
+		}
+		for (;;) {
+			if (!fn()) {
+				return false;
+			}
+			if (peek() == ',') {
+				pos++;
+				continue;
+			}
+			return expect(']');
+		}
+	}
+
+	// Consumes one value of any type, checking its syntax without keeping anything
+	bool skip_value() {
+		m_closers.clear();
+		for (;;) {
+			JsonString text;
+			switch (peek()) {
+			case '{':
+			case '[':
+			{
+				if (m_depth + m_closers.size() >= depth_limit()) {
+					return fail(error_kind::depth_exceeded);
+				}
+				const char close = j[pos] == '{' ? '}' : ']';
+				pos++;
+				if (peek() == close) {
+					pos++;
+					break;
+				}
+				m_closers.push_back(close);
+				if (close == '}' && !parse_key(text)) {
+					return false;
+				}
+				continue;
+			}
+			case '"':
+				if (!parse_string(text)) {
+					return false;
+				}
+				break;
+			case 'n':
+			case 't':
+			case 'f':
+				if (!skip_literal()) {
+					return false;
+				}
+				break;
+			default:
+			{
+				double number;
+				if (!is_number_start(j[pos])) {
+					return fail(error_kind::invalid_value);
+				}
+				if (!parse_number(number)) {
+					return false;
+				}
+				break;
+			}
+			}
+			for (;;) {
+				if (m_closers.empty()) {
+					return true;
+				}
+				if (peek() == ',') {
+					pos++;
+					if (m_closers.back() == '}' && !parse_key(text)) {
+						return false;
+					}
+					break;
+				}
+				if (!expect(m_closers.back())) {
+					return false;
+				}
+				m_closers.pop_back();
+			}
+		}
+	}
+
+protected:
+	std::vector<char> m_closers;	// brackets skip_value still has to see, innermost last
+	size_t m_depth = 0;				// containers a decoder has open around the current value
+
+	json_error locate(error_kind kind, size_t offset) const {
+		offset = (std::min)(offset, j.size());
+		const auto first = j.begin(), last = j.begin() + offset;
+		const auto lineStart = std::find(std::make_reverse_iterator(last), std::make_reverse_iterator(first), '\n').base();
+		return { kind, offset, static_cast<size_t>(std::count(first, last, '\n')) + 1, static_cast<size_t>(last - lineStart) + 1 };
+	}
+
+	static bool is_whitespace(char c) {
+		return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+	}
+
+	// Compact input has at most one separator between tokens, pretty-printed input has long runs
+	// of indentation that are skipped 16 bytes at a time
+	void parse_whitespace() {
+		while (is_whitespace(j[pos])) {
+			pos++;
+#if defined(JPARSER_SSE2)
+			while (pos + 16 <= j.size()) {
+				const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&j[pos]));
+				const auto space = _mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))),
+					_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+				const uint32_t other = ~_mm_movemask_epi8(space) & 0xFFFF;
+				if (other) {
+					pos += trailing_zeros(other);
+					return;
+				}
+				pos += 16;
+			}
+#endif
+		}
+	}
+
+	bool expect(const char* s) {
+		parse_whitespace();
+		for (auto p = s; *p; p++, pos++) {
+			if (*p != j[pos]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	char* peek_ptr() {
+		parse_whitespace();
+		return &j[pos];
+	}
+
+	static bool is_number_start(char c) {
+		return std::isdigit(static_cast<unsigned char>(c)) || c == '+' || c == '-';
+	}
+
+	bool skip_literal() {
+		const auto start = pos;
+		const char* spelling = j[pos] == 'n' ? "null" : j[pos] == 't' ? "true" : "false";
+		if (expect(spelling)) {
+			return true;
+		}
+		pos = start;
+		return fail(error_kind::invalid_literal);
+	}
+
+	// Decodes j[begin, end) into arena memory. Decoded text is never longer than its escaped form.
+	bool unescape(size_t begin, size_t end, JsonString& text) {
+		const auto out = static_cast<char*>(g_arena.Alloc(end - begin));
+		auto o = out;
+		size_t bad;
+		if (!unescape_json<true>(&j[begin], end - begin, o, options.validate_utf8, bad)) {
+			return fail_at(begin + bad, error_kind::invalid_escape);
+		}
+		text = JsonString(out, o - out);
+		return true;
+	}
+};
+
+// Builds a DOM tree. Policy picks the containers of the documents it builds, see storage_policy.
+template<class Policy>
+struct basic_json_parser : json_scanner {
+	using job_type = basic_job<Policy>;
+	using array_type = typename job_type::array_type;
+	using dict_type = typename job_type::dict_type;
+
+	std::vector<parse_frame<job_type>> stack;
+	basic_json_parser() {}
+	basic_json_parser(std::string json, parse_options opts = {}) :json_scanner(std::move(json), opts) {}
+
+	expected<job_type, json_error> try_parse() {
+		rewind();
+		stack.clear();
+		job_type root;
+		if (!parse_value(root) || !expect_end()) {
+			stack.clear();
+			return make_unexpected(error());
+		}
+		return root;
+	}
+
+#if !defined(JPARSER_NO_EXCEPTIONS)
+	job_type parse() {
+		auto result = try_parse();
+		if (!result) {
+			throw parse_error(result.error());
+		}
+		return std::move(*result);
+	}
+#endif
+
+private:
+	std::vector<double> m_packed;	// numbers of the array parse_packed is reading
+
+	// Reads the key of the next member of the frame's dict and where its text starts
+	bool parse_frame_key(parse_frame<job_type>& frame) {
+		const bool quoted = peek() == '"';
+		frame.key_pos = pos + quoted;	// first character of the key, as the other errors in strings report
+		return parse_key(frame.key);
+	}
+
+	// Called with pos at a bracket, fails if the container it opens is one level too many
+	bool check_depth() {
+		return stack.size() < depth_limit() || fail(error_kind::depth_exceeded);
+	}
+
+	void push_container(job_type container, bool is_dict) {
+		stack.push_back({ std::move(container), JsonString(), 0, is_dict });
+	}
+
+	// Iterative descent: open containers live on an explicit stack instead of the call stack,
+	// so nesting costs one frame and adversarial depth fails with an error rather than a crash.
+	bool parse_value(job_type& result) {
+		for (;;) {
+			job_type current;
+			switch (peek()) {
+			case 'n':
+			case 'f':
+			case 't':
+				if (!parse_literal(current)) {
+					return false;
+				}
+				break;
+			case '"':
+			{
+				JsonString text;
+				bool escaped = false;
+				if (!(options.lazy_strings ? parse_raw_string(text, escaped) : parse_string(text))) {
+					return false;
+				}
+				if (escaped) {
+					current = JsonRawString{ text.data(), static_cast<uint32_t>(text.size()) };
+				}
+				else {
+					current = text;
+				}
+				break;
+			}
+			case '{':
+			{
+				if (!check_depth()) {
+					return false;
+				}
+				pos++;
+				if (peek() == '}') {
+					pos++;
+					current = dict_type();
+					break;
+				}
+				push_container(dict_type(), true);
+				if (!parse_frame_key(stack.back())) {
+					return false;
+				}
+				continue;
+			}
+			case '[':
+			{
+				if (!check_depth()) {
+					return false;
+				}
+				pos++;
+				if (peek() == ']') {
+					pos++;
+					current = array_type();
+					break;
+				}
+				if (options.pack_numbers && parse_packed(current)) {
+					break;
+				}
+				push_container(array_type(), false);
+				continue;
+			}
+			default:
+			{
+				double number;
+				JsonString text;
+				if (!is_number_start(peek())) {
+					return fail(error_kind::invalid_value);
+				}
+				if (options.lazy_numbers && parse_raw_number(text)) {
+					current = JsonRawNumber{ text.data(), static_cast<uint32_t>(text.size()) };
+					break;
+				}
+				if (!parse_number(number)) {
+					return false;
+				}
+				current = number;
+				break;
+			}
+			}
+
+			// Hand the finished value to its parent, closing every container that ends here
+			for (;;) {
+				if (stack.empty()) {
+					result = std::move(current);
+					return true;
+				}
+				auto& top = stack.back();
+				if (top.is_dict) {
+					auto& dict = *std::get_if<dict_type>(&top.container.value);
+					if (!dict.emplace(insert_key<dict_type>(top.key), std::move(current)).second) {
+						return fail_at(top.key_pos, error_kind::duplicate_key);
+					}
+					if (peek() == ',') {
+						pos++;
+						if (!parse_frame_key(top)) {
+							return false;
+						}
+						break;
+					}
+					if (!expect('}')) {
+						return false;
+					}
+				}
+				else {
+					std::get_if<array_type>(&top.container.value)->push_back(std::move(current));
+					if (peek() == ',') {
+						pos++;
+						break;
+					}
+					if (!expect(']')) {
+						return false;
+					}
+				}
+				current = std::move(top.container);
+				stack.pop_back();
+			}
+		}
+	}
+
+	// Reads the rest of an array of numbers, or of equally long non-empty arrays of numbers, into
+	// one arena buffer. Anything else, errors included, rewinds to just after the opening bracket and
+	// is left to the generic path, which then only repeats the numeric prefix.
+	bool parse_packed(job_type& result) {
+		const auto start = pos;
+		const auto abandon = [&] {
+			pos = start;
+			failure = error_kind::none;
+			return false;
+		};
+		const bool tuples = peek() == '[';
+		if (stack.size() + tuples >= depth_limit()) {
+			return false;
+		}
+		m_packed.clear();
+		uint32_t width = 0;
+		double number;
+		for (;;) {
+			if (tuples) {
+				pos++;
+				uint32_t n = 0;
+				for (;; n++) {
+					if (!is_number_start(peek()) || !parse_number(number)) {
+						return abandon();
+					}
+					m_packed.push_back(number);
+					if (peek() != ',') {
+						break;
+					}
+					pos++;
+				}
+				if (peek() != ']' || (width != 0 && n + 1 != width)) {
+					return abandon();
+				}
+				pos++;
+				width = n + 1;
+			}
+			else if (!is_number_start(peek()) || !parse_number(number)) {
+				return abandon();
+			}
+			else {
+				m_packed.push_back(number);
+			}
+			if (peek() == ',') {
+				pos++;
+				if (tuples && peek() != '[') {
+					return abandon();
+				}
+				continue;
+			}
+			if (peek() != ']') {
+				return abandon();
+			}
+			pos++;
+			break;
+		}
+		const auto values = static_cast<double*>(g_arena.Alloc(m_packed.size() * sizeof(double)));
+		std::memcpy(values, m_packed.data(), m_packed.size() * sizeof(double));
+		result = JsonNumbers{ { values, m_packed.size() }, width };
+		return true;
+	}
+
+	bool parse_literal(job_type& literal) {
+		const auto start = pos;
+		switch (j[pos]) {
+		case 'n':
+			if (expect("null")) {
+				literal = job_type();
+				return true;
+			}
+			break;
+		case 't':
+			if (expect("true")) {
+				literal = job_type(true);
+				return true;
+			}
+			break;
+		case 'f':
+			if (expect("false")) {
+				literal = job_type(false);
+				return true;
+			}
+			break;
+		}
+		pos = start;
+		return fail(error_kind::invalid_literal);
+	}
+
+};
+
+
+using json_parser = basic_json_parser<default_policy>;
+
+template<class Policy>
+std::istream& operator>>(std::istream& ifs, basic_json_parser<Policy>& jp) {
+	jp = basic_json_parser<Policy>(std::string{ std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{} });
+	return ifs;
+}
@@ -0,0 +1,449 @@
+#pragma once
+
+// Typed decoding of JSON straight into C++ structs. A struct lists its fields once:
+//
+//     struct price { int64_t amount; int64_t seat_category; std::optional<JsonString> note; };
+//     JPARSER_FIELDS(price, JPARSER_FIELD(amount), JPARSER_FIELD_AS(seat_category, "seatCategoryId"), JPARSER_FIELD(note))
+//
+// and json_struct_parser fills it from json_scanner without building a DOM. Member keys are found
+// through a perfect hash table computed at compile time from the field list, so a key costs one
+// hash and one comparison whatever the number of fields.
+//
+// Supported members: bool, integers (exact, up to 64 bits), floating point, std::string (copied),
+// JsonString (a view of the input, or of g_arena for escaped strings), std::vector<T>, std::map and
+// std::unordered_map with string keys for objects used as dictionaries, std::optional<T>, and structs
+// with their own JPARSER_FIELDS. Fields other than std::optional must be present and may not be
+// null. Members the struct does not list are skipped.
+//
+// The same field list drives write_typed, which writes a struct through json_writer without a job
+// tree in between. Keys are escaped and quoted at compile time, so writing one is a single copy.
+// An empty std::optional is written as null.
+
+#include "jparser.h"
+#include <array>
+#include <limits>
+#include <optional>
+#include <tuple>
+
+template<class T, class M>
+struct json_field {
+	JsonString key;
+	M T::* member;
+};
+
+template<class T, class M>
+constexpr json_field<T, M> make_json_field(JsonString key, M T::* member) {
+	return { key, member };
+}
+
+// Specialized for every bound struct by JPARSER_FIELDS, value is a tuple of json_field
+template<class T>
+struct json_fields;
+
+#define JPARSER_FIELDS(Type, ...) \
+	template<> struct json_fields<Type> { \
+		using type = Type; \
+		static constexpr auto value = std::make_tuple(__VA_ARGS__); \
+	};
+#define JPARSER_FIELD(member) make_json_field(#member, &type::member)
+#define JPARSER_FIELD_AS(member, key) make_json_field(key, &type::member)
+
+template<class T, class = void>
+struct has_json_fields : std::false_type {};
+
+template<class T>
+struct has_json_fields<T, std::void_t<decltype(json_fields<T>::value)>> : std::true_type {};
+
+template<class T>
+inline constexpr size_t json_field_count = std::tuple_size_v<std::decay_t<decltype(json_fields<T>::value)>>;
+
+template<class T>
+struct is_optional : std::false_type {};
+
+template<class T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template<class T>
+struct is_vector : std::false_type {};
+
+template<class T, class A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template<class T, class = void>
+struct is_string_map : std::false_type {};
+
+template<class T>
+struct is_string_map<T, std::void_t<typename T::mapped_type, decltype(std::declval<T&>().try_emplace(std::declval<typename T::key_type>()))>> :
+	std::bool_constant<std::is_constructible_v<typename T::key_type, JsonString>> {};
+
+// Seeded FNV-1a
+constexpr uint64_t key_hash(JsonString key, uint64_t seed) {
+	uint64_t h = 0xcbf29ce484222325ull ^ (seed * 0x9e3779b97f4a7c15ull);
+	for (const char c : key) {
+		h = (h ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+	}
+	return h ^ (h >> 32);
+}
+
+// Collision-free table from the keys of N fields to their index. Eight slots per key keep the
+// seed search short (a few dozen tries for 64 keys) at one byte per slot.
+template<size_t N>
+struct key_table {
+	static_assert(N > 0 && N < 255, "a bound struct needs between 1 and 254 fields");
+	static constexpr size_t Size = [] {
+		size_t size = 8;
+		while (size < N * 8) {
+			size *= 2;
+		}
+		return size;
+	}();
+
+	uint64_t seed = 0;
+	bool found = false;
+	uint8_t slots[Size] = {};	// field index + 1, 0 for an empty slot
+	JsonString keys[N] = {};
+
+	// Index of the field with this key, -1 for keys the struct does not have
+	constexpr int find(JsonString key) const {
+		const auto slot = slots[key_hash(key, seed) & (Size - 1)];
+		return slot != 0 && keys[slot - 1] == key ? slot - 1 : -1;
+	}
+};
+
+template<class T>
+constexpr auto make_key_table() {
+	constexpr size_t N = json_field_count<T>;
+	key_table<N> table{};
+	std::apply([&](const auto&... fields) {
+		size_t i = 0;
+		((table.keys[i++] = fields.key), ...);
+		}, json_fields<T>::value);
+	for (uint64_t seed = 0; seed < 4096; seed++) {
+		for (auto& slot : table.slots) {
+			slot = 0;
+		}
+		size_t i = 0;
+		for (; i < N; i++) {
+			auto& slot = table.slots[key_hash(table.keys[i], seed) & (key_table<N>::Size - 1)];
+			if (slot != 0) {
+				break;
+			}
+			slot = static_cast<uint8_t>(i + 1);
+		}
+		if (i == N) {
+			table.seed = seed;
+			table.found = true;
+			break;
+		}
+	}
+	return table;
+}
+
+// Decodes documents into bound structs, see JPARSER_FIELDS. A type mismatch, a missing required
+// field or a null in a non-optional one fails with error_kind::invalid_schema at the offending value.
+// Structs, arrays and maps nested deeper than parse_options::max_depth fail with depth_exceeded.
+struct json_struct_parser : json_scanner {
+	json_struct_parser() {}
+	json_struct_parser(std::string json, parse_options opts = {}) :json_scanner(std::move(json), opts) {}
+
+	// Decodes into value, which is reset first. False with error() set on failure.
+	template<class T>
+	bool decode(T& value) {
+		rewind();
+		value = T{};
+		return read(value) && expect_end();
+	}
+
+	template<class T>
+	expected<T, json_error> try_parse() {
+		T value{};
+		if (!decode(value)) {
+			return make_unexpected(error());
+		}
+		return value;
+	}
+
+#if !defined(JPARSER_NO_EXCEPTIONS)
+	template<class T>
+	T parse() {
+		auto result = try_parse<T>();
+		if (!result) {
+			throw parse_error(result.error());
+		}
+		return std::move(*result);
+	}
+#endif
+
+private:
+	bool mismatch() {
+		return fail(error_kind::invalid_schema);
+	}
+
+	template<class V>
+	bool read(V& value) {
+		if constexpr (std::is_same_v<V, bool>) {
+			const char c = peek();
+			if (c != 't' && c != 'f') {
+				return mismatch();
+			}
+			value = c == 't';
+			return skip_literal();
+		}
+		else if constexpr (std::is_integral_v<V>) {
+			return read_integer(value);
+		}
+		else if constexpr (std::is_floating_point_v<V>) {
+			double number;
+			if (!is_number_start(peek())) {
+				return mismatch();
+			}
+			if (!parse_number(number)) {
+				return false;
+			}
+			value = static_cast<V>(number);
+			return true;
+		}
+		else if constexpr (std::is_same_v<V, JsonString> || std::is_same_v<V, std::string>) {
+			JsonString text;
+			if (peek() != '"') {
+				return mismatch();
+			}
+			if (!parse_string(text)) {
+				return false;
+			}
+			value = V(text);
+			return true;
+		}
+		else if constexpr (is_optional<V>::value) {
+			if (peek() == 'n') {
+				value.reset();
+				return skip_literal();
+			}
+			return read(value.emplace());
+		}
+		else if constexpr (is_vector<V>::value) {
+			if (peek() != '[') {
+				return mismatch();
+			}
+			value.clear();
+			return nested([&] { return parse_elements([&] { return read(value.emplace_back()); }); });
+		}
+		else if constexpr (is_string_map<V>::value) {
+			if (peek() != '{') {
+				return mismatch();
+			}
+			value.clear();
+			return nested([&] {
+				return parse_members([&](JsonString key) { return read(value.try_emplace(typename V::key_type(key)).first->second); });
+				});
+		}
+		else {
+			static_assert(has_json_fields<V>::value, "member type has no JSON binding, declare its fields with JPARSER_FIELDS");
+			return read_struct(value);
+		}
+	}
+
+	// Integers are read exactly, twitter's 64-bit ids do not survive a trip through double. Values
+	// written with a fraction or exponent are accepted when they are whole and in range.
+	template<class V>
+	bool read_integer(V& value) {
+		const char* p = peek_ptr();
+		const auto start = pos;
+		if (!is_number_start(*p)) {
+			return mismatch();
+		}
+		const bool negative = *p == '-';
+		const char* q = p + negative;
+		uint64_t magnitude = 0;
+		bool overflow = false;
+		for (; static_cast<unsigned>(*q - '0') < 10; q++) {
+			const unsigned d = *q - '0';
+			overflow |= magnitude > (std::numeric_limits<uint64_t>::max() - d) / 10;
+			magnitude = magnitude * 10 + d;
+		}
+		const uint64_t limit = negative ? uint64_t(std::numeric_limits<V>::max()) + std::is_signed_v<V> : uint64_t(std::numeric_limits<V>::max());
+		if (q == p + negative || *q == '.' || *q == 'e' || *q == 'E' || overflow) {
+			double number;
+			if (!parse_number(number)) {
+				return false;
+			}
+			// max() rounds up to 2^digits as a double, so the upper bound is that power of two, exclusive
+			constexpr double Upper = double(uint64_t(1) << (std::numeric_limits<V>::digits - 1)) * 2;
+			if (number != std::floor(number) || number < double(std::numeric_limits<V>::min()) || number >= Upper) {
+				return fail_at(start, error_kind::invalid_schema);
+			}
+			value = static_cast<V>(number);
+			return true;
+		}
+		if (magnitude > limit || (negative && std::is_unsigned_v<V> && magnitude != 0)) {
+			return mismatch();
+		}
+		value = negative ? static_cast<V>(0 - magnitude) : static_cast<V>(magnitude);
+		pos += q - p;
+		return true;
+	}
+
+	template<class T, size_t I>
+	bool read_member(T& object) {
+		return read(object.*(std::get<I>(json_fields<T>::value).member));
+	}
+
+	template<class T, size_t... I>
+	static constexpr auto member_readers(std::index_sequence<I...>) {
+		return std::array<bool (json_struct_parser::*)(T&), sizeof...(I)>{ &json_struct_parser::read_member<T, I>... };
+	}
+
+	template<class T, size_t... I>
+	static constexpr auto required_members(std::index_sequence<I...>) {
+		return std::array<bool, sizeof...(I)>{ !is_optional<std::decay_t<decltype(std::declval<T&>().*(std::get<I>(json_fields<T>::value).member))>>::value... };
+	}
+
+	template<class T>
+	bool read_struct(T& object) {
+		constexpr size_t N = json_field_count<T>;
+		static constexpr auto Table = make_key_table<T>();
+		static_assert(Table.found, "field keys must be distinct");
+		static constexpr auto Readers = member_readers<T>(std::make_index_sequence<N>());
+		static constexpr auto Required = required_members<T>(std::make_index_sequence<N>());
+		if (peek() != '{') {
+			return mismatch();
+		}
+		const auto start = pos;
+		std::array<bool, N> seen{};
+		const bool ok = nested([&] {
+			return parse_members([&](JsonString key) {
+				const int i = Table.find(key);
+				if (i < 0) {
+					return skip_value();
+				}
+				seen[i] = true;
+				return (this->*Readers[i])(object);
+				});
+			});
+		if (!ok) {
+			return false;
+		}
+		for (size_t i = 0; i < N; i++) {
+			if (Required[i] && !seen[i]) {
+				return fail_at(start, error_kind::invalid_schema);
+			}
+		}
+		return true;
+	}
+};
+
+// Length of a key in the output, quotes included
+constexpr size_t escaped_key_size(JsonString key) {
+	size_t size = 2;
+	for (const char c : key) {
+		char escape[6] = {};
+		size += json_writer::needs_escape(c) ? json_writer::write_escape(c, escape) - escape : 1;
+	}
+	return size;
+}
+
+// The keys of a struct's fields as they appear in the output, "key" for field i at
+// text[offsets[i], offsets[i + 1])
+template<size_t N, size_t Bytes>
+struct escaped_key_table {
+	char text[Bytes] = {};
+	uint32_t offsets[N + 1] = {};
+
+	constexpr JsonString operator[](size_t i) const {
+		return { text + offsets[i], offsets[i + 1] - offsets[i] };
+	}
+};
+
+template<class T>
+constexpr size_t escaped_keys_size() {
+	return std::apply([](const auto&... fields) { return (escaped_key_size(fields.key) + ... + size_t(0)); }, json_fields<T>::value);
+}
+
+template<class T>
+constexpr auto make_escaped_keys() {
+	escaped_key_table<json_field_count<T>, escaped_keys_size<T>()> table{};
+	std::apply([&](const auto&... fields) {
+		size_t size = 0, i = 0;
+		const auto add = [&](JsonString key) {
+			table.text[size++] = '"';
+			for (const char c : key) {
+				if (json_writer::needs_escape(c)) {
+					size = json_writer::write_escape(c, table.text + size) - table.text;
+				}
+				else {
+					table.text[size++] = c;
+				}
+			}
+			table.text[size++] = '"';
+			table.offsets[++i] = static_cast<uint32_t>(size);
+		};
+		(add(fields.key), ...);
+		}, json_fields<T>::value);
+	return table;
+}
+
+template<class V>
+void write_typed_value(json_writer& writer, const V& value);
+
+template<class T, size_t... I>
+void write_members(json_writer& writer, const T& object, std::index_sequence<I...>) {
+	static constexpr auto Keys = make_escaped_keys<T>();
+	((writer.escaped_key(Keys[I]), write_typed_value(writer, object.*(std::get<I>(json_fields<T>::value).member))), ...);
+}
+
+// Writes any value json_struct_parser can decode through the event API of writer, so it can also
+// fill a member of a document that is being written
+template<class V>
+void write_typed_value(json_writer& writer, const V& value) {
+	if constexpr (std::is_same_v<V, bool>) {
+		writer.value(JsonBoolean(value));
+	}
+	else if constexpr (std::is_integral_v<V>) {
+		writer.value(value);
+	}
+	else if constexpr (std::is_floating_point_v<V>) {
+		writer.value(static_cast<JsonNumber>(value));
+	}
+	else if constexpr (std::is_same_v<V, JsonString> || std::is_same_v<V, std::string>) {
+		writer.value(JsonString(value));
+	}
+	else if constexpr (is_optional<V>::value) {
+		if (value) {
+			write_typed_value(writer, *value);
+		}
+		else {
+			writer.value(JsonNull{});
+		}
+	}
+	else if constexpr (is_vector<V>::value) {
+		writer.begin_array();
+		for (const auto& e : value) {
+			write_typed_value(writer, e);
+		}
+		writer.end_array();
+	}
+	else if constexpr (is_string_map<V>::value) {
+		writer.begin_dict();
+		for (const auto& e : value) {
+			writer.key(JsonString(e.first));
+			write_typed_value(writer, e.second);
+		}
+		writer.end_dict();
+	}
+	else {
+		static_assert(has_json_fields<V>::value, "member type has no JSON binding, declare its fields with JPARSER_FIELDS");
+		writer.begin_dict();
+		write_members(writer, value, std::make_index_sequence<json_field_count<V>>());
+		writer.end_dict();
+	}
+}
+
+// The counterpart of json_writer::write for bound values. The view stays valid until the next
+// write; a streaming writer flushes instead and returns an empty view.
+template<class V>
+std::string_view write_typed(json_writer& writer, const V& value) {
+	writer.clear();
+	write_typed_value(writer, value);
+	writer.flush();
+	return writer.view();
+}
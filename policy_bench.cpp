@@ -0,0 +1,208 @@
+// policy_bench.cpp : Times every stock storage policy on the same corpus, so the DOM layout can be
+// chosen per workload instead of by editing the container typedefs.
+//
+// usage: jparser_policy_bench [--data DIR] [--filter TEXT] [--min-iters N]
+//
+// Each file gets one table per stage with the policies side by side, relative to default_policy,
+// followed by a summary of the fastest policy for every file and stage.
+
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include "nanobench.h"
+#include "jparser.h"
+#include <filesystem>
+#include <iomanip>
+
+#ifndef JPARSER_DATA_DIR
+#define JPARSER_DATA_DIR "data"
+#endif
+
+struct policy_options {
+	std::string data = JPARSER_DATA_DIR;
+	std::string filter;
+	uint64_t min_iters = 10;
+};
+
+// Fastest policy of one stage on one file
+struct policy_winner {
+	std::string file;
+	std::string stage;
+	std::string policy;
+	double seconds_per_doc;
+	double default_seconds_per_doc;
+};
+
+template<class Job>
+void traverse(const Job& value, size_t& values, double& sum) {
+	values++;
+	std::visit(overloaded{
+		[&](JsonNumber number) { sum += number; },
+		[&](JsonBoolean boolean) { sum += boolean; },
+		[&](JsonString text) { sum += text.size(); },
+		[&](JsonNull) {},
+		[&](const typename Job::array_type& array) {
+			for (const auto& e : array) {
+				traverse(e, values, sum);
+			}
+		},
+		[&](const typename Job::dict_type& dict) {
+			for (const auto& e : dict) {
+				sum += JsonString(e.first).size();
+				traverse(e.second, values, sum);
+			}
+		},
+		[&](const JsonNumbers& numbers) {
+			values += numbers.values.size();
+			for (const auto n : numbers.values) {
+				sum += n;
+			}
+		},
+		[&](const JsonRawNumber& number) { sum += number.to_double(); },
+		[&](const JsonRawString& text) { sum += text.value().size(); },
+		}, value.value);
+}
+
+template<class Policy>
+struct policy_tag {
+	using type = Policy;
+};
+
+// Calls fn(policy_tag<P>{}, name) for every stock policy, default_policy first
+template<class Fn>
+void for_each_policy(Fn&& fn) {
+	fn(policy_tag<default_policy>{}, "default");
+	fn(policy_tag<heap_vector_tree_policy>{}, "heap vector/tree");
+	fn(policy_tag<heap_vector_hash_policy>{}, "heap vector/hash");
+	fn(policy_tag<heap_list_tree_policy>{}, "heap list/tree");
+	fn(policy_tag<heap_list_hash_policy>{}, "heap list/hash");
+	fn(policy_tag<arena_vector_tree_policy>{}, "arena vector/tree");
+	fn(policy_tag<arena_vector_hash_policy>{}, "arena vector/hash");
+	fn(policy_tag<arena_list_tree_policy>{}, "arena list/tree");
+	fn(policy_tag<arena_list_hash_policy>{}, "arena list/hash");
+	fn(policy_tag<heap_vector_interned_policy>{}, "heap vector/ids");
+	fn(policy_tag<arena_vector_interned_policy>{}, "arena vector/ids");
+	fn(policy_tag<heap_vector_shaped_policy>{}, "heap vector/shape");
+	fn(policy_tag<arena_vector_shaped_policy>{}, "arena vector/shape");
+}
+
+bool parse_args(int argc, char** argv, policy_options& options) {
+	for (int i = 1; i < argc; i++) {
+		const std::string_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--data" && hasValue) {
+			options.data = argv[++i];
+		}
+		else if (arg == "--filter" && hasValue) {
+			options.filter = argv[++i];
+		}
+		else if (arg == "--min-iters" && hasValue) {
+			options.min_iters = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else {
+			std::cerr << "usage: jparser_policy_bench [--data DIR] [--filter TEXT] [--min-iters N]" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// The first run of a bench is default_policy
+void collect_winner(const std::string& file, const char* stage, const ankerl::nanobench::Bench& bench, std::vector<policy_winner>& winners) {
+	using Measure = ankerl::nanobench::Result::Measure;
+	const auto& results = bench.results();
+	const auto best = std::min_element(results.begin(), results.end(), [](const auto& a, const auto& b) {
+		return a.median(Measure::elapsed) < b.median(Measure::elapsed);
+		});
+	winners.push_back({ file, stage, best->config().mBenchmarkName, best->median(Measure::elapsed), results.front().median(Measure::elapsed) });
+}
+
+int main(int argc, char** argv)
+{
+	policy_options options;
+	if (!parse_args(argc, argv, options)) {
+		return 2;
+	}
+	std::vector<std::filesystem::path> filenames;
+	for (const auto& entry : std::filesystem::directory_iterator(options.data)) {
+		if (entry.is_regular_file() && entry.path().filename().string().find(options.filter) != std::string::npos) {
+			filenames.push_back(entry.path());
+		}
+	}
+	std::sort(filenames.begin(), filenames.end());
+
+	std::vector<policy_winner> winners;
+	for (const auto& each : filenames) {
+		std::ifstream ifs(each, std::ios::in | std::ios::binary);
+		const std::string text{ std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{} };
+		const auto name = each.filename().string();
+		if (auto checked = json_parser(text).try_parse(); !checked) {
+			std::cout << name << " error: " << checked.error() << std::endl;
+			continue;
+		}
+		g_arena.Reset();
+
+		// One Bench per stage, each running every policy in turn, so a table compares the policies
+		const auto makeBench = [&](const char* stage) {
+			ankerl::nanobench::Bench bench;
+			bench.title(name + " " + stage).unit("byte").batch(text.size()).minEpochIterations(options.min_iters).warmup(1).relative(true);
+			return bench;
+		};
+		auto parse = makeBench("parse");
+		for_each_policy([&](auto tag, const char* policy) {
+			basic_json_parser<typename decltype(tag)::type> jp(text);
+			parse.run(policy, [&] {
+				{
+					auto parsed = jp.try_parse();
+					ankerl::nanobench::doNotOptimizeAway(parsed);
+				}
+				g_arena.Reset();
+				});
+			});
+		// Traversal and serialization need a live document, the arena is reset once it is gone
+		auto traverse = makeBench("traverse");
+		for_each_policy([&](auto tag, const char* policy) {
+			{
+				// The document's strings are views into the parser's text, so the parser must outlive it
+				basic_json_parser<typename decltype(tag)::type> jp(text);
+				const auto doc = *jp.try_parse();
+				traverse.run(policy, [&] {
+					size_t values = 0;
+					double sum = 0;
+					::traverse(doc, values, sum);
+					ankerl::nanobench::doNotOptimizeAway(sum);
+					});
+			}
+			g_arena.Reset();
+			});
+		auto serialize = makeBench("serialize");
+		json_writer writer;
+		for_each_policy([&](auto tag, const char* policy) {
+			{
+				// The document's strings are views into the parser's text, so the parser must outlive it
+				basic_json_parser<typename decltype(tag)::type> jp(text);
+				const auto doc = *jp.try_parse();
+				serialize.run(policy, [&] {
+					ankerl::nanobench::doNotOptimizeAway(writer.write(doc));
+					});
+			}
+			g_arena.Reset();
+			});
+
+		collect_winner(name, "parse", parse, winners);
+		collect_winner(name, "traverse", traverse, winners);
+		collect_winner(name, "serialize", serialize, winners);
+		json_reset_keys();
+	}
+
+	std::cout << "\n| " << std::setw(24) << std::left << "file" << " | " << std::setw(10) << "stage" << " | " << std::setw(18) << "fastest"
+		<< " | " << std::setw(10) << std::right << "MB/s" << " | " << std::setw(11) << "vs default" << " |\n";
+	std::cout << "|:" << std::string(24, '-') << "-|:" << std::string(10, '-') << "-|:" << std::string(18, '-') << "-|-"
+		<< std::string(10, '-') << ":|-" << std::string(11, '-') << ":|\n";
+	for (const auto& w : winners) {
+		const auto bytes = std::filesystem::file_size(std::filesystem::path(options.data) / w.file);
+		std::cout << "| " << std::setw(24) << std::left << w.file << " | " << std::setw(10) << w.stage << " | " << std::setw(18) << w.policy
+			<< " | " << std::right << std::fixed << std::setprecision(1) << std::setw(10) << bytes / w.seconds_per_doc * 1e-6 << " | "
+			<< std::setw(10) << (w.default_seconds_per_doc / w.seconds_per_doc - 1) * 100 << "% |\n";
+	}
+	g_arena.Release();
+	return 0;
+}